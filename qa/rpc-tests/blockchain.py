@@ -76,7 +76,7 @@ class BlockchainTest(BitcoinTestFramework):
 
     def _test_gettxoutsetinfo(self):
         node = self.nodes[0]
-        res = node.gettxoutsetinfo()
+        res = node.gettxoutsetinfo("hash_serialized_2")
 
         assert_equal(res['total_amount'], Decimal('8725.00000000'))
         assert_equal(res['transactions'], 200)
@@ -89,28 +89,45 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(len(res['bestblock']), 64)
         assert_equal(len(res['hash_serialized_2']), 64)
 
+        logging.info ("Test that the running statistics match a full scan")
+        mu = node.gettxoutsetinfo()
+        assert_equal(mu['total_amount'], res['total_amount'])
+        assert_equal(mu['height'], 200)
+        assert_equal(mu['txouts'], 200)
+        assert_equal(mu['bestblock'], res['bestblock'])
+        assert_equal(len(mu['muhash']), 64)
+        verify = node.gettxoutsetinfo("verify")
+        assert_equal(verify['verified'], True)
+        assert_equal(verify['muhash'], mu['muhash'])
+        assert_raises(JSONRPCException, node.gettxoutsetinfo, "nonsense")
+
         logging.info ("Test that gettxoutsetinfo() works for blockchain with just the genesis block")
         b1hash = node.getblockhash(1)
         node.invalidateblock(b1hash)
 
-        res2 = node.gettxoutsetinfo()
+        res2 = node.gettxoutsetinfo("hash_serialized_2")
         assert_equal(res2['transactions'], 0)
         assert_equal(res2['total_amount'], Decimal('0'))
         assert_equal(res2['height'], 0)
         assert_equal(res2['txouts'], 0)
         assert_equal(res2['bestblock'], node.getblockhash(0))
         assert_equal(len(res2['hash_serialized_2']), 64)
+        mu2 = node.gettxoutsetinfo()
+        assert_equal(mu2['txouts'], 0)
+        assert_equal(mu2['total_amount'], Decimal('0'))
+        assert_equal(node.gettxoutsetinfo("verify")['verified'], True)
 
         logging.info ("Test that gettxoutsetinfo() returns the same result after invalidate/reconsider block")
         node.reconsiderblock(b1hash)
 
-        res3 = node.gettxoutsetinfo()
+        res3 = node.gettxoutsetinfo("hash_serialized_2")
         assert_equal(res['total_amount'], res3['total_amount'])
         assert_equal(res['transactions'], res3['transactions'])
         assert_equal(res['height'], res3['height'])
         assert_equal(res['txouts'], res3['txouts'])
         assert_equal(res['bestblock'], res3['bestblock'])
         assert_equal(res['hash_serialized_2'], res3['hash_serialized_2'])
+        assert_equal(node.gettxoutsetinfo()['muhash'], mu['muhash'])
 
     def _test_getblockheader(self):
         node = self.nodes[0]
@@ -301,6 +318,12 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(res['bytes'], 0)
         assert_equal(res['maxmempool'], 300000000)
         assert_equal(res['mempoolminfee'], Decimal('0E-8'))
+        # one input queue per admission thread, all idle
+        assert(len(res['txadmission']) >= 1)
+        for (i, thread) in enumerate(res['txadmission']):
+            assert_equal(thread['thread'], i)
+            assert_equal(thread['queued'], 0)
+            assert_equal(thread['enqueued'], thread['processed'])
 
         # orphan pool
         res2 = node.getorphanpoolinfo()
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Unlimited developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+import test_framework.loginit
+#
+# Test dumping the UTXO set with dumptxoutset and starting a new node from it with -loadutxosnapshot
+#
+
+import logging
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+class UTXOSnapshotTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 2)
+
+    def setup_network(self):
+        self.nodes = []
+        self.nodes.append(start_node(0, self.options.tmpdir, ["-debug"]))
+        self.is_network_split = False
+
+    def run_test(self):
+        logging.info("Mining blocks...")
+        self.nodes[0].generate(101)
+        for i in range(10):
+            self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 1)
+        self.nodes[0].generate(10)
+
+        logging.info("Dumping the UTXO set...")
+        info = self.nodes[0].gettxoutsetinfo("hash_serialized_2")
+        snapshot = self.nodes[0].dumptxoutset("utxo.dat")
+        assert_equal(snapshot['height'], 111)
+        assert_equal(snapshot['bestblock'], info['bestblock'])
+        assert_equal(snapshot['coins_written'], info['txouts'])
+        assert_equal(snapshot['hash_serialized_2'], info['hash_serialized_2'])
+        try:
+            self.nodes[0].dumptxoutset("utxo.dat")
+            raise AssertionError("dumptxoutset overwrote an existing file")
+        except JSONRPCException as e:
+            assert("already exists" in e.error['message'])
+
+        logging.info("Starting a node from the snapshot...")
+        args = ["-debug", "-loadutxosnapshot=" + snapshot['path'], "-assumeutxohash=" + info['hash_serialized_2']]
+        self.nodes.append(start_node(1, self.options.tmpdir, args))
+        assert_equal(self.nodes[1].getblockcount(), 111)
+        assert_equal(self.nodes[1].getbestblockhash(), info['bestblock'])
+        assert_equal(self.nodes[1].gettxoutsetinfo("hash_serialized_2")['hash_serialized_2'], info['hash_serialized_2'])
+        assert_equal(self.nodes[1].gettxoutsetinfo()['muhash'], self.nodes[0].gettxoutsetinfo()['muhash'])
+
+        logging.info("Following the chain from the snapshot...")
+        connect_nodes(self.nodes[0], 1)
+        for i in range(5):
+            self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 1)
+        self.nodes[0].generate(5)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[1].getblockcount(), 116)
+        assert_equal(self.nodes[1].gettxoutsetinfo("hash_serialized_2")['hash_serialized_2'],
+                     self.nodes[0].gettxoutsetinfo("hash_serialized_2")['hash_serialized_2'])
+        assert_equal(self.nodes[1].gettxoutsetinfo()['muhash'], self.nodes[0].gettxoutsetinfo()['muhash'])
+
+        logging.info("Restarting the snapshot node...")
+        stop_node(self.nodes[1], 1)
+        self.nodes[1] = start_node(1, self.options.tmpdir, args)
+        assert_equal(self.nodes[1].getblockcount(), 116)
+        connect_nodes(self.nodes[0], 1)
+        self.nodes[0].generate(1)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[1].getbestblockhash(), self.nodes[0].getbestblockhash())
+
+
+if __name__ == '__main__':
+    UTXOSnapshotTest().main()
@@ -19,6 +19,7 @@
 #include "requestManager.h"
 #include "respend/respendrelayer.h"
 #include "script/sigcache.h"
+#include "socketevents.h"
 #include "tinyformat.h"
 #include "torcontrol.h"
 #include "tweak.h"
@@ -27,6 +28,7 @@
 #include "util.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
+#include "utxostats.h"
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
 #endif
@@ -285,7 +287,19 @@ static void addGeneralOptions(AllowedArgs &allowedArgs, HelpMessageMode mode)
     allowedArgs
         .addArg("dbcache=<n>", requiredInt, strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"),
                                                 nMinDbCache, nMaxDbCache, nDefaultDbCache))
+        .addArg("dbbackgroundflush", optionalBool,
+            strprintf(_("Write flushed coins to the coin database on a background thread (default: %u)"),
+                    DEFAULT_DB_BACKGROUND_FLUSH))
         .addArg("loadblock=<file>", requiredStr, _("Imports blocks from external blk000??.dat file on startup"))
+        .addArg("loadutxosnapshot=<file>", requiredStr,
+            _("Start a new node from the UTXO snapshot in <file>, written by dumptxoutset, instead of syncing the "
+              "blocks below it. Requires -assumeutxohash"))
+        .addArg("assumeutxohash=<hex>", requiredStr,
+            _("The hash_serialized_2 that gettxoutsetinfo reports for the snapshot block on a trusted node"))
+        .addArg("utxostats", optionalBool,
+            strprintf(_("Keep the UTXO set statistics up to date as blocks are connected, so that gettxoutsetinfo "
+                        "does not need to scan the coin database (default: %u)"),
+                    DEFAULT_UTXOSTATS))
         .addArg("maxorphantx=<n>", requiredInt,
             strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"),
                     DEFAULT_MAX_ORPHAN_TRANSACTIONS))
@@ -388,6 +402,9 @@ static void addConnectionOptions(AllowedArgs &allowedArgs)
                 _("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"),
                 DEFAULT_PROXYRANDOMIZE))
         .addArg("seednode=<ip>", requiredStr, _("Connect to a node to retrieve peer addresses, and disconnect"))
+        .addArg("socketbackend=<backend>", requiredStr,
+            strprintf(_("Mechanism used to wait for network socket activity, select or epoll (linux only) (default: %s)"),
+                    DEFAULT_SOCKET_BACKEND))
         .addArg("timeout=<n>", requiredInt,
             strprintf(
                     _("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT))
@@ -8,6 +8,7 @@
 #include "crypto/sha256.h"
 #include "key.h"
 #include "main.h"
+#include "pubkey.h"
 #include "sync.h"
 #include "util.h"
 
@@ -19,6 +20,7 @@ int main(int argc, char **argv)
 {
     SHA256AutoDetect();
     ECC_Start();
+    ECCVerifyHandle verifyHandle;
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
 
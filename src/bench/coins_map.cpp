@@ -0,0 +1,94 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "coins.h"
+#include "coinsflatmap.h"
+#include "crypto/common.h"
+#include "random.h"
+
+// Enough coins that neither map fits in the CPU caches, as with a node's dbcache
+static const uint64_t BENCH_COINS = 10000000;
+
+static COutPoint BenchOutPoint(uint64_t n)
+{
+    uint256 hash;
+    WriteLE64(hash.begin(), n / 2);
+    return COutPoint(hash, n % 2);
+}
+
+static CCoinsCacheEntry BenchEntry(uint64_t n)
+{
+    CCoinsCacheEntry entry;
+    entry.coin.out.nValue = n;
+    entry.coin.nHeight = 1 + n % 500000;
+    // a pay to public key hash script, which is stored inline in the script's prevector
+    entry.coin.out.scriptPubKey.assign(25, (unsigned char)0x76);
+    entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+    return entry;
+}
+
+template <typename Map>
+static void FillMap(Map &map, uint64_t nCoins)
+{
+    for (uint64_t n = 0; n < nCoins; n++)
+        map[BenchOutPoint(n)] = BenchEntry(n);
+}
+
+// The time to load BENCH_COINS coins into an empty map, as the coins cache does while it warms up
+template <typename Map>
+static void CoinsMapInsert(benchmark::State &state)
+{
+    while (state.KeepRunning())
+    {
+        Map map;
+        FillMap(map, BENCH_COINS);
+    }
+}
+
+// Lookups of random coins in a full map
+template <typename Map>
+static void CoinsMapLookup(benchmark::State &state)
+{
+    Map map;
+    FillMap(map, BENCH_COINS);
+    FastRandomContext rand(true);
+    uint64_t nFound = 0;
+    while (state.KeepRunning())
+        nFound += map.find(BenchOutPoint(rand.rand32() % BENCH_COINS)) != map.end();
+    assert(nFound > 0);
+}
+
+// A pass over every coin in a full map writing back the dirty ones, as a flush of the coins cache does
+template <typename Map>
+static void CoinsMapFlush(benchmark::State &state)
+{
+    Map map;
+    FillMap(map, BENCH_COINS);
+    while (state.KeepRunning())
+    {
+        CAmount nTotal = 0;
+        for (auto &item : map)
+        {
+            if (item.second.flags & CCoinsCacheEntry::DIRTY)
+                nTotal += item.second.coin.out.nValue;
+            item.second.flags ^= CCoinsCacheEntry::DIRTY;
+        }
+        assert(nTotal >= 0);
+    }
+}
+
+static void CoinsMapInsert_UnorderedMap(benchmark::State &state) { CoinsMapInsert<CCoinsMap>(state); }
+static void CoinsMapInsert_FlatMap(benchmark::State &state) { CoinsMapInsert<CCoinsFlatMap>(state); }
+static void CoinsMapLookup_UnorderedMap(benchmark::State &state) { CoinsMapLookup<CCoinsMap>(state); }
+static void CoinsMapLookup_FlatMap(benchmark::State &state) { CoinsMapLookup<CCoinsFlatMap>(state); }
+static void CoinsMapFlush_UnorderedMap(benchmark::State &state) { CoinsMapFlush<CCoinsMap>(state); }
+static void CoinsMapFlush_FlatMap(benchmark::State &state) { CoinsMapFlush<CCoinsFlatMap>(state); }
+
+BENCHMARK(CoinsMapInsert_UnorderedMap);
+BENCHMARK(CoinsMapInsert_FlatMap);
+BENCHMARK(CoinsMapLookup_UnorderedMap);
+BENCHMARK(CoinsMapLookup_FlatMap);
+BENCHMARK(CoinsMapFlush_UnorderedMap);
+BENCHMARK(CoinsMapFlush_FlatMap);
@@ -55,6 +55,24 @@ static void SHA256_32b(benchmark::State &state)
     }
 }
 
+static void SHA256D64_1024(benchmark::State &state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning())
+        SHA256D64(in.data(), in.data(), 1024);
+}
+
+static void SHA256D64_1024_Single(benchmark::State &state)
+{
+    // the same hashes one at a time, as they were computed before SHA256D64
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning())
+    {
+        for (int i = 0; i < 1024; i++)
+            CHash256().Write(&in[64 * i], 64).Finalize(&in[32 * i]);
+    }
+}
+
 static void SHA512(benchmark::State &state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -107,6 +125,8 @@ BENCHMARK(SHA256);
 BENCHMARK(SHA512);
 
 BENCHMARK(SHA256_32b);
+BENCHMARK(SHA256D64_1024);
+BENCHMARK(SHA256D64_1024_Single);
 BENCHMARK(SipHash_32b);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
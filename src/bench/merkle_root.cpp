@@ -0,0 +1,65 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "consensus/merkle.h"
+#include "parallel.h"
+#include "random.h"
+#include "uint256.h"
+#include "util.h"
+
+static void MerkleRoot(benchmark::State &state)
+{
+    std::vector<uint256> leaves;
+    leaves.resize(9001);
+    for (auto &item : leaves)
+        item = GetRandHash();
+    while (state.KeepRunning())
+    {
+        bool mutation = false;
+        uint256 hash = ComputeMerkleRoot(leaves, &mutation);
+        leaves[mutation] = hash;
+    }
+}
+
+// The merkle root of a block of nTx transactions, as CheckBlock computes it
+static void BlockMerkleRoot(benchmark::State &state, size_t nTx, bool fParallel)
+{
+    CBlock block;
+    block.vtx.reserve(nTx);
+    for (size_t i = 0; i < nTx; i++)
+    {
+        CMutableTransaction tx;
+        tx.nLockTime = i;
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+
+    SoftSetArg("-par", "4");
+    CParallelValidation pv;
+    while (state.KeepRunning())
+    {
+        bool mutated = false;
+        uint256 root = fParallel ? pv.BlockMerkleRoot(block, &mutated) : BlockMerkleRoot(block, &mutated);
+        assert(!mutated && !root.IsNull());
+    }
+}
+
+static void BlockMerkleRoot_1k(benchmark::State &state) { BlockMerkleRoot(state, 1000, false); }
+static void BlockMerkleRoot_10k(benchmark::State &state) { BlockMerkleRoot(state, 10000, false); }
+static void BlockMerkleRoot_100k(benchmark::State &state) { BlockMerkleRoot(state, 100000, false); }
+static void BlockMerkleRoot_1M(benchmark::State &state) { BlockMerkleRoot(state, 1000000, false); }
+static void BlockMerkleRootParallel_1k(benchmark::State &state) { BlockMerkleRoot(state, 1000, true); }
+static void BlockMerkleRootParallel_10k(benchmark::State &state) { BlockMerkleRoot(state, 10000, true); }
+static void BlockMerkleRootParallel_100k(benchmark::State &state) { BlockMerkleRoot(state, 100000, true); }
+static void BlockMerkleRootParallel_1M(benchmark::State &state) { BlockMerkleRoot(state, 1000000, true); }
+
+BENCHMARK(MerkleRoot);
+BENCHMARK(BlockMerkleRoot_1k);
+BENCHMARK(BlockMerkleRoot_10k);
+BENCHMARK(BlockMerkleRoot_100k);
+BENCHMARK(BlockMerkleRoot_1M);
+BENCHMARK(BlockMerkleRootParallel_1k);
+BENCHMARK(BlockMerkleRootParallel_10k);
+BENCHMARK(BlockMerkleRootParallel_100k);
+BENCHMARK(BlockMerkleRootParallel_1M);
@@ -0,0 +1,64 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "key.h"
+#include "pubkey.h"
+#include "random.h"
+
+#include <assert.h>
+
+// Number of signatures checked per iteration, about what a batch of script checks holds
+static const size_t SCHNORR_BENCH_SIGS = 128;
+
+struct SchnorrBenchData
+{
+    std::vector<CPubKey> vPubKeys;
+    std::vector<uint256> vHashes;
+    std::vector<std::vector<uint8_t> > vSigs;
+
+    SchnorrBenchData()
+    {
+        for (size_t i = 0; i < SCHNORR_BENCH_SIGS; i++)
+        {
+            CKey key;
+            key.MakeNewKey(true);
+            vPubKeys.push_back(key.GetPubKey());
+            vHashes.push_back(GetRandHash());
+            vSigs.emplace_back();
+            bool fSigned = key.SignSchnorr(vHashes.back(), vSigs.back());
+            assert(fSigned);
+        }
+    }
+};
+
+static void SchnorrVerifyIndividual(benchmark::State &state)
+{
+    SchnorrBenchData data;
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SCHNORR_BENCH_SIGS; i++)
+        {
+            bool fValid = data.vPubKeys[i].VerifySchnorr(data.vHashes[i], data.vSigs[i]);
+            assert(fValid);
+        }
+    }
+}
+
+static void SchnorrVerifyBatch(benchmark::State &state)
+{
+    SchnorrBenchData data;
+    CSchnorrBatch batch;
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SCHNORR_BENCH_SIGS; i++)
+            batch.Add(data.vPubKeys[i], data.vHashes[i], data.vSigs[i]);
+        bool fValid = batch.Verify();
+        assert(fValid);
+        batch.clear();
+    }
+}
+
+BENCHMARK(SchnorrVerifyIndividual);
+BENCHMARK(SchnorrVerifyBatch);
@@ -4,7 +4,9 @@
 
 #include "blockrelay/blockrelay_common.h"
 #include "blockrelay/graphene.h"
+#include "hashwrapper.h"
 #include "net.h"
+#include "netbufferpool.h"
 #include "random.h"
 #include "requestManager.h"
 #include "sync.h"
@@ -366,3 +368,108 @@ void ThinTypeRelay::ClearAllBlockData(CNode *pnode, std::shared_ptr<CBlockThinRe
     // Now clear the block in flight.
     ClearBlockInFlight(pnode, hash);
 }
+
+CRecentBlockCache::CRecentBlockCache() : hits("net/recentBlocks/hits"), misses("net/recentBlocks/misses") {}
+uint32_t CRecentBlockCache::Add(const uint256 &hash, const CSerializeData &msg)
+{
+    assert(msg.size() >= CMessageHeader::HEADER_SIZE);
+    uint256 hashMsg = Hash(msg.begin() + CMessageHeader::HEADER_SIZE, msg.end());
+    uint32_t nChecksum;
+    memcpy(&nChecksum, &hashMsg, sizeof(nChecksum));
+
+    if (Contains(hash))
+        return nChecksum;
+
+    // Take the copy before locking, a block may be tens of megabytes
+    std::shared_ptr<const CSerializeData> pdata = std::make_shared<const CSerializeData>(msg);
+    std::shared_ptr<const CSerializeData> pEvicted;
+    {
+        LOCK(cs_recent);
+        // another thread may have added it in the meantime
+        for (const CEntry &entry : vEntries)
+        {
+            if (entry.hash == hash)
+                return nChecksum;
+        }
+        vEntries.push_back({hash, nChecksum, pdata});
+        if (vEntries.size() > RECENT_BLOCK_CACHE_SIZE)
+        {
+            // free it outside of the lock since this cleanses the memory
+            pEvicted = vEntries.front().pdata;
+            vEntries.pop_front();
+        }
+    }
+    return nChecksum;
+}
+
+bool CRecentBlockCache::PushBlock(CNode *pfrom, const uint256 &hash)
+{
+    std::shared_ptr<const CSerializeData> pdata;
+    uint32_t nChecksum = 0;
+    {
+        LOCK(cs_recent);
+        for (const CEntry &entry : vEntries)
+        {
+            if (entry.hash == hash)
+            {
+                pdata = entry.pdata;
+                nChecksum = entry.nChecksum;
+                break;
+            }
+        }
+        if (!pdata)
+        {
+            misses += 1;
+            return false;
+        }
+        hits += 1;
+    }
+
+    CSerializeData msg;
+    netBufferPool.Get(msg, pdata->size());
+    msg.assign(pdata->begin(), pdata->end());
+    pfrom->PushRawMessage(NetMsgType::BLOCK, msg, &nChecksum);
+    return true;
+}
+
+void CRecentBlockCache::PushBlock(CNode *pfrom, const CBlock &block)
+{
+    const uint256 hash = block.GetHash();
+    if (PushBlock(pfrom, hash))
+        return;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss.reserve(CMessageHeader::HEADER_SIZE + block.GetBlockSize());
+    ss.resize(CMessageHeader::HEADER_SIZE);
+    ss << block;
+    CSerializeData msg;
+    ss.swap(msg);
+    uint32_t nChecksum = Add(hash, msg);
+    pfrom->PushRawMessage(NetMsgType::BLOCK, msg, &nChecksum);
+}
+
+bool CRecentBlockCache::Contains(const uint256 &hash)
+{
+    LOCK(cs_recent);
+    for (const CEntry &entry : vEntries)
+    {
+        if (entry.hash == hash)
+            return true;
+    }
+    return false;
+}
+
+void CRecentBlockCache::Clear()
+{
+    std::deque<CEntry> vOld;
+    {
+        LOCK(cs_recent);
+        vOld.swap(vEntries);
+    }
+}
+
+void CRecentBlockCache::Stop()
+{
+    hits.Stop();
+    misses.Stop();
+}
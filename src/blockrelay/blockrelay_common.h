@@ -6,8 +6,11 @@
 #define BITCOIN_BLOCKRELAY_COMMON_H
 
 #include "net.h"
+#include "stat.h"
 #include "utiltime.h"
 
+#include <deque>
+#include <memory>
 #include <stdint.h>
 
 class CNode;
@@ -90,4 +93,52 @@ public:
 };
 extern ThinTypeRelay thinrelay;
 
+/** How many of the most recently sent blocks CRecentBlockCache keeps */
+static const size_t RECENT_BLOCK_CACHE_SIZE = 3;
+
+/** The serialized form of the last few blocks sent in full.
+
+    A new block is usually sent in full to many peers at about the same time, either because they asked for it or
+    because a thin type block for them would have been bigger than the block.  The cache lets all of them share one
+    serialization and one checksum.  Xthin, compact and graphene blocks are not cached since each is built for a
+    particular peer, from its bloom filter, its known inventory or its mempool size.
+ */
+class CRecentBlockCache
+{
+protected:
+    struct CEntry
+    {
+        uint256 hash;
+        uint32_t nChecksum;
+        //! the serialized block, preceded by CMessageHeader::HEADER_SIZE bytes of room for the message header
+        std::shared_ptr<const CSerializeData> pdata;
+    };
+
+    CCriticalSection cs_recent;
+    std::deque<CEntry> vEntries GUARDED_BY(cs_recent); // newest last
+
+public:
+    //! blocks sent from the cache
+    CStatHistory<uint64_t> hits;
+    //! blocks that had to be serialized or read from disk
+    CStatHistory<uint64_t> misses;
+
+    CRecentBlockCache();
+
+    /** Remember msg, a serialized block with room for the message header in front.  Returns the checksum of the
+        block to pass on to CNode::PushRawMessage. */
+    uint32_t Add(const uint256 &hash, const CSerializeData &msg);
+    /** Send the block to pfrom if it is cached, return false if it is not */
+    bool PushBlock(CNode *pfrom, const uint256 &hash);
+    /** Send the block to pfrom, serializing and caching it first if needed */
+    void PushBlock(CNode *pfrom, const CBlock &block);
+
+    bool Contains(const uint256 &hash);
+    void Clear();
+
+    /** Stop the statistics timers before shutdown */
+    void Stop();
+};
+extern CRecentBlockCache recentblocks;
+
 #endif // BITCOIN_BLOCKRELAY_COMMON_H
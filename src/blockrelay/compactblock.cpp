@@ -1077,7 +1077,7 @@ void SendCompactBlock(ConstCBlockRef pblock, CNode *pfrom, const CInv &inv)
         }
         else // send full block
         {
-            pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+            recentblocks.PushBlock(pfrom, *pblock);
             LOG(CMPCT, "Sent regular block instead - compactblock size: %d vs block size: %d , peer: %s\n",
                 compactBlock.GetSize(), nSizeBlock, pfrom->GetLogName());
         }
@@ -1246,7 +1246,7 @@ void SendGrapheneBlock(CBlockRef pblock, CNode *pfrom, const CInv &inv, const CM
             // If graphene block is larger than a regular block then send a regular block instead
             if (nSizeGrapheneBlock > nSizeBlock)
             {
-                pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+                recentblocks.PushBlock(pfrom, *pblock);
                 LOG(GRAPHENE, "Sent regular block instead - graphene block size: %d vs block size: %d => peer: %s\n",
                     nSizeGrapheneBlock, nSizeBlock, pfrom->GetLogName());
             }
@@ -1266,7 +1266,7 @@ void SendGrapheneBlock(CBlockRef pblock, CNode *pfrom, const CInv &inv, const CM
         }
         catch (const std::runtime_error &e)
         {
-            pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+            recentblocks.PushBlock(pfrom, *pblock);
             LOG(GRAPHENE,
                 "Sent regular block instead - encountered error when creating graphene block for peer %s: %s\n",
                 pfrom->GetLogName(), e.what());
@@ -1337,11 +1337,7 @@ CMemPoolInfo GetGrapheneMempoolInfo()
 {
     // We need the number of transactions in the mempool and orphanpools but also the number
     // in the txCommitQ that have been processed and valid, and which will be in the mempool shortly.
-    uint64_t nCommitQ = 0;
-    {
-        boost::unique_lock<boost::mutex> lock(csCommitQ);
-        nCommitQ = txCommitQ->size();
-    }
+    uint64_t nCommitQ = txCommitQ.Size();
     return CMemPoolInfo(mempool.size() + orphanpool.GetOrphanPoolSize() + nCommitQ);
 }
 void RequestFailoverBlock(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock)
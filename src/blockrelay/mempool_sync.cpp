@@ -385,13 +385,7 @@ bool CMempoolSyncTx::HandleMessage(CDataStream &vRecv, CNode *pfrom)
 
 void GetMempoolTxHashes(std::vector<uint256> &mempoolTxHashes)
 {
-    {
-        boost::unique_lock<boost::mutex> lock(csCommitQ);
-        for (auto &kv : *txCommitQ)
-        {
-            mempoolTxHashes.push_back(kv.first);
-        }
-    }
+    txCommitQ.QueryHashes(mempoolTxHashes);
 
     {
         READLOCK(orphanpool.cs_orphanpool);
@@ -414,11 +408,7 @@ CMempoolSyncInfo GetMempoolSyncInfo()
 {
     // We need the number of transactions in the mempool and orphanpools but also the number
     // in the txCommitQ that have been processed and valid, and which will be in the mempool shortly.
-    uint64_t nCommitQ = 0;
-    {
-        boost::unique_lock<boost::mutex> lock(csCommitQ);
-        nCommitQ = txCommitQ->size();
-    }
+    uint64_t nCommitQ = txCommitQ.Size();
 
     uint64_t nTxInMempool = mempool.size() + orphanpool.GetOrphanPoolSize() + nCommitQ;
     uint64_t nMempoolMaxTxBytes = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
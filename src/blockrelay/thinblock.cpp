@@ -1327,7 +1327,7 @@ void SendXThinBlock(ConstCBlockRef pblock, CNode *pfrom, const CInv &inv)
             }
             else
             {
-                pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+                recentblocks.PushBlock(pfrom, *pblock);
                 LOG(THIN, "Sent regular block instead - thinblock size: %d vs block size: %d => tx hashes: %d "
                           "transactions: %d  peer: %s\n",
                     thinBlock.GetSize(), nSizeBlock, thinBlock.vTxHashes.size(), thinBlock.vMissingTx.size(),
@@ -1349,7 +1349,7 @@ void SendXThinBlock(ConstCBlockRef pblock, CNode *pfrom, const CInv &inv)
             }
             else
             {
-                pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+                recentblocks.PushBlock(pfrom, *pblock);
                 LOG(THIN, "Sent regular block instead - xthinblock size: %d vs block size: %d => tx hashes: %d "
                           "transactions: %d  peer: %s\n",
                     xThinBlock.GetSize(), nSizeBlock, xThinBlock.vTxHashes.size(), xThinBlock.vMissingTx.size(),
@@ -1376,7 +1376,7 @@ void SendXThinBlock(ConstCBlockRef pblock, CNode *pfrom, const CInv &inv)
         }
         else
         {
-            pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+            recentblocks.PushBlock(pfrom, *pblock);
             LOG(THIN, "Sent regular block instead - thinblock size: %d vs block size: %d => tx hashes: %d "
                       "transactions: %d  peer: %s\n",
                 thinBlock.GetSize(), nSizeBlock, thinBlock.vTxHashes.size(), thinBlock.vMissingTx.size(),
@@ -1633,11 +1633,9 @@ void BuildSeededBloomFilter(CBloomFilter &filterMemPool,
 
     // Also add all the transaction hashes currently in the txCommitQ
     {
-        boost::unique_lock<boost::mutex> lock(csCommitQ);
-        for (auto &it : *txCommitQ)
-        {
-            setHighScoreMemPoolHashes.insert(it.first);
-        }
+        std::vector<uint256> vCommitQHashes;
+        txCommitQ.QueryHashes(vCommitQHashes);
+        setHighScoreMemPoolHashes.insert(vCommitQHashes.begin(), vCommitQHashes.end());
     }
 
     LOG(THIN, "Bloom Filter Targeting completed in:%d (ms)\n", GetTimeMillis() - nStartTimer);
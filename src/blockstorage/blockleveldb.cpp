@@ -47,6 +47,31 @@ bool CBlockLevelDB::ReadBlock(const CBlockIndex *pindex, CBlock &block)
     return pwrapperblock->Read(key.str(), block);
 }
 
+bool CBlockLevelDB::ReadBlockRaw(const CBlockIndex *pindex, CSerializeData &data, size_t nOffset)
+{
+    std::ostringstream key;
+    key << pindex->GetBlockTime() << ":" << pindex->GetBlockHash().ToString();
+    std::string strValue;
+    if (!pwrapperblock->Exists(key.str(), strValue))
+        return false;
+
+    data.resize(nOffset + strValue.size());
+    memcpy(&data[nOffset], strValue.data(), strValue.size());
+
+    // undo the obfuscation the same way CDataStream::Xor does, but only over the block
+    const std::vector<unsigned char> obfuscate_key = pwrapperblock->getobfuscate_key();
+    if (!obfuscate_key.empty())
+    {
+        for (size_t i = nOffset, j = 0; i < data.size(); i++)
+        {
+            data[i] ^= obfuscate_key[j++];
+            if (j == obfuscate_key.size())
+                j = 0;
+        }
+    }
+    return true;
+}
+
 bool CBlockLevelDB::EraseBlock(CBlock &block)
 {
     std::ostringstream key;
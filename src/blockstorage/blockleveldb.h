@@ -116,6 +116,7 @@ public:
 
     bool WriteBlock(const CBlock &block);
     bool ReadBlock(const CBlockIndex *pindex, CBlock &block);
+    bool ReadBlockRaw(const CBlockIndex *pindex, CSerializeData &data, size_t nOffset);
     bool EraseBlock(CBlock &block);
     bool EraseBlock(const CBlockIndex *pindex);
 
@@ -14,6 +14,7 @@
 #include "sequential_files.h"
 #include "ui_interface.h"
 #include "undo.h"
+#include "utxostats.h"
 #include "validation/validation.h"
 
 extern bool AbortNode(CValidationState &state, const std::string &strMessage, const std::string &userMessage = "");
@@ -489,6 +490,36 @@ bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(CSerializeData &data,
+    size_t nOffset,
+    const CBlockIndex *pindex,
+    const CMessageHeader::MessageStartChars &messageStart)
+{
+    data.clear();
+    if (!pblockdb)
+    {
+        if (!ReadRawBlockFromDiskSequential(data, nOffset, pindex->GetBlockPos(), messageStart))
+        {
+            return false;
+        }
+    }
+    else if (!pblockdb->ReadBlockRaw(pindex, data, nOffset))
+    {
+        LOGA("failed to read block with hash %s from leveldb \n", pindex->GetBlockHash().GetHex().c_str());
+        return false;
+    }
+
+    // The block hash is the hash of the serialized header at the start of the block
+    const size_t nHeaderSize = ::GetSerializeSize(CBlockHeader(), SER_NETWORK, PROTOCOL_VERSION);
+    if (data.size() < nOffset + nHeaderSize ||
+        Hash(data.begin() + nOffset, data.begin() + nOffset + nHeaderSize) != pindex->GetBlockHash())
+    {
+        return error("ReadRawBlockFromDisk: block data doesn't match index for %s at %s", pindex->ToString(),
+            pindex->GetBlockPos().ToString());
+    }
+    return true;
+}
+
 bool WriteUndoToDisk(const CBlockUndo &blockundo,
     CDiskBlockPos &pos,
     const CBlockIndex *pindex,
@@ -679,6 +710,15 @@ bool FlushStateToDiskInternal(CValidationState &state,
         {
             return AbortNode(state, "Failed to write to coin database");
         }
+        // Coins are otherwise committed on a background thread, but a forced flush must leave them on disk.
+        if (mode == FLUSH_STATE_ALWAYS && pcoinsdbview && !pcoinsdbview->WaitForFlush())
+        {
+            return AbortNode(state, "Failed to write to coin database");
+        }
+        if (g_utxostats && pcoinsdbview && !pcoinsdbview->WriteUTXOStats(*g_utxostats))
+        {
+            return AbortNode(state, "Failed to write to coin database");
+        }
         nLastFlush = nNow;
         // Trim any excess entries from the cache if needed.  If chain is not syncd then
         // trim extra so that we don't flush as often during IBD.
@@ -41,6 +41,12 @@ void SyncStorage(const CChainParams &chainparams);
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus::Params &consensusParams);
 bool WriteBlockToDisk(const CBlock &block, CDiskBlockPos &pos, const CMessageHeader::MessageStartChars &messageStart);
+/** Read a block's serialized bytes, without deserializing it, into data starting nOffset bytes in.  The bytes in
+    front of nOffset are left for the caller, e.g. to put a network message header there. */
+bool ReadRawBlockFromDisk(CSerializeData &data,
+    size_t nOffset,
+    const CBlockIndex *pindex,
+    const CMessageHeader::MessageStartChars &messageStart);
 
 bool WriteUndoToDisk(const CBlockUndo &blockundo,
     CDiskBlockPos &pos,
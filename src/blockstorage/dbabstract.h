@@ -6,6 +6,7 @@
 #define BITCOIN_DBABSTRACT_H
 
 #include "chain.h"
+#include "support/allocators/zeroafterfree.h"
 #include "undo.h"
 
 enum BlockDBMode
@@ -34,6 +35,9 @@ public:
     //! Read a block from the database
     virtual bool ReadBlock(const CBlockIndex *pindex, CBlock &block) = 0;
 
+    //! Read a block's serialized bytes into data, starting nOffset bytes in
+    virtual bool ReadBlockRaw(const CBlockIndex *pindex, CSerializeData &data, size_t nOffset) = 0;
+
     //! Remove a block from the database
     virtual bool EraseBlock(CBlock &block) = 0;
 
@@ -140,6 +140,47 @@ bool ReadBlockFromDiskSequential(CBlock &block, const CDiskBlockPos &pos, const
     return true;
 }
 
+bool ReadRawBlockFromDiskSequential(CSerializeData &data,
+    size_t nOffset,
+    const CDiskBlockPos &pos,
+    const CMessageHeader::MessageStartChars &messageStart)
+{
+    // The block is preceded by the network magic and its size, see WriteBlockToDiskSequential
+    const unsigned int nIndexHeaderSize = MESSAGE_START_SIZE + sizeof(unsigned int);
+    if (pos.nPos < nIndexHeaderSize)
+    {
+        return error("ReadRawBlockFromDisk: Invalid position %s", pos.ToString());
+    }
+    CDiskBlockPos posHeader(pos.nFile, pos.nPos - nIndexHeaderSize);
+    CAutoFile filein(OpenBlockFile(posHeader, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+    {
+        return error("ReadRawBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    }
+
+    try
+    {
+        CMessageHeader::MessageStartChars blkStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blkStart) >> nSize;
+        if (memcmp(blkStart, messageStart, MESSAGE_START_SIZE) != 0)
+        {
+            return error("ReadRawBlockFromDisk: Block magic mismatch at %s", pos.ToString());
+        }
+        if (nSize < GetSerializeSize(CBlockHeader(), SER_NETWORK, PROTOCOL_VERSION) || nSize > MAX_BLOCKFILE_SIZE)
+        {
+            return error("ReadRawBlockFromDisk: Invalid block size %u at %s", nSize, pos.ToString());
+        }
+        data.resize(nOffset + nSize);
+        filein.read(&data[nOffset], nSize);
+    }
+    catch (const std::exception &e)
+    {
+        return error("%s: I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
 /* Calculate the amount of disk space the block & undo files currently use */
 uint64_t CalculateCurrentUsage()
 {
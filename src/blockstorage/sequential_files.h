@@ -34,6 +34,10 @@ bool WriteBlockToDiskSequential(const CBlock &block,
     CDiskBlockPos &pos,
     const CMessageHeader::MessageStartChars &messageStart);
 bool ReadBlockFromDiskSequential(CBlock &block, const CDiskBlockPos &pos, const Consensus::Params &consensusParams);
+bool ReadRawBlockFromDiskSequential(CSerializeData &data,
+    size_t nOffset,
+    const CDiskBlockPos &pos,
+    const CMessageHeader::MessageStartChars &messageStart);
 void FindFilesToPruneSequential(std::set<int> &setFilesToPrune, uint64_t nPruneAfterHeight);
 bool WriteUndoToDiskSequenatial(const CBlockUndo &blockundo,
     CDiskBlockPos &pos,
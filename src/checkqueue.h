@@ -17,6 +17,19 @@
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Lets a type of check defer part of its work so that it can be done once for a whole batch of checks.
+ * A worker calls Begin() before it runs a batch and End() after, passing in whether the batch succeeded so far,
+ * and End() returns whether it still does.  By default nothing is deferred.
+ */
+template <typename T>
+class CCheckQueueBatch
+{
+public:
+    void Begin() {}
+    bool End(bool fOk) { return fOk; }
+};
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -73,6 +86,7 @@ private:
     bool Loop(bool fMaster = false)
     {
         boost::condition_variable &cond = fMaster ? condMaster : condWorker;
+        CCheckQueueBatch<T> batch;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
         unsigned int nNow = 0;
@@ -143,9 +157,11 @@ private:
                 fOk = fAllOk;
             }
             // execute work
+            batch.Begin();
             for (T &check : vChecks)
                 if (fOk)
                     fOk = check();
+            fOk = batch.End(fOk);
             vChecks.clear();
         } while (true);
     }
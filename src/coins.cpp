@@ -39,6 +39,47 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins,
 }
 CCoinsViewCursor *CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
+CCoinsStatsHasher::CCoinsStatsHasher(CCoinsStats &statsIn, const uint256 &hashBlock)
+    : stats(statsIn), ss(SER_GETHASH, PROTOCOL_VERSION)
+{
+    stats.hashBlock = hashBlock;
+    ss << hashBlock;
+}
+
+void CCoinsStatsHasher::ApplyStats()
+{
+    ss << prevkey;
+    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase,
+        VarIntMode::NONNEGATIVE_SIGNED);
+    stats.nTransactions++;
+    for (const auto &output : outputs)
+    {
+        ss << VARINT(output.first + 1);
+        ss << *(const CScriptBase *)(&output.second.out.scriptPubKey);
+        ss << VARINT(output.second.out.nValue, VarIntMode::NONNEGATIVE_SIGNED);
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += output.second.out.nValue;
+    }
+    ss << VARINT(0u);
+    outputs.clear();
+}
+
+void CCoinsStatsHasher::Add(const COutPoint &key, Coin &&coin)
+{
+    if (!outputs.empty() && key.hash != prevkey)
+        ApplyStats();
+    prevkey = key.hash;
+    outputs[key.n] = std::move(coin);
+}
+
+uint256 CCoinsStatsHasher::Finalize()
+{
+    if (!outputs.empty())
+        ApplyStats();
+    stats.hashSerialized = ss.GetHash();
+    return stats.hashSerialized;
+}
+
 SaltedOutpointHasher::SaltedOutpointHasher()
     : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max()))
 {
@@ -515,6 +556,327 @@ double CCoinsViewCache::GetPriority(const CTransaction &tx, int nHeight, CAmount
 }
 
 
+CCoinsViewShardedCache::CCoinsViewShardedCache(CCoinsView *baseIn, unsigned int nShards)
+    : CCoinsViewBacked(baseIn), nBestCoinHeight(0)
+{
+    assert(nShards > 0);
+    for (unsigned int i = 0; i < nShards; i++)
+        vShards.emplace_back(new Shard());
+}
+
+void CCoinsViewShardedCache::UpdateBestCoinHeight(uint64_t nHeight) const
+{
+    uint64_t nBest = nBestCoinHeight.load();
+    while (nBest < nHeight && !nBestCoinHeight.compare_exchange_weak(nBest, nHeight))
+    {
+    }
+}
+
+CCoinsMap::iterator CCoinsViewShardedCache::FetchCoin(Shard &shard, const COutPoint &outpoint) const
+{
+    CCoinsMap::iterator it = shard.cacheCoins.find(outpoint);
+    if (it != shard.cacheCoins.end())
+        return it;
+    Coin tmp;
+    if (!base->GetCoin(outpoint, tmp))
+        return shard.cacheCoins.end();
+
+    it = shard.cacheCoins
+             .emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp)))
+             .first;
+    if (it->second.coin.IsSpent())
+    {
+        // The parent only has an empty entry for this outpoint; we can consider our
+        // version as fresh.
+        it->second.flags = CCoinsCacheEntry::FRESH;
+    }
+    shard.cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    UpdateBestCoinHeight(it->second.coin.nHeight);
+    return it;
+}
+
+bool CCoinsViewShardedCache::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    Shard &shard = GetShard(outpoint);
+    {
+        // Most lookups are hits, which only need the shared lock
+        READLOCK(shard.cs_shard);
+        CCoinsMap::const_iterator it = shard.cacheCoins.find(outpoint);
+        if (it != shard.cacheCoins.end())
+        {
+            coin = it->second.coin;
+            return true;
+        }
+    }
+    WRITELOCK(shard.cs_shard);
+    CCoinsMap::const_iterator it = FetchCoin(shard, outpoint);
+    if (it == shard.cacheCoins.end())
+        return false;
+    coin = it->second.coin;
+    return true;
+}
+
+bool CCoinsViewShardedCache::HaveCoin(const COutPoint &outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, coin) && !coin.IsSpent();
+}
+
+Coin CCoinsViewShardedCache::AccessCoin(const COutPoint &outpoint) const
+{
+    Coin coin;
+    GetCoin(outpoint, coin);
+    return coin;
+}
+
+bool CCoinsViewShardedCache::HaveCoinInCache(const COutPoint &outpoint, bool &fSpent) const
+{
+    Shard &shard = GetShard(outpoint);
+    READLOCK(shard.cs_shard);
+    CCoinsMap::const_iterator it = shard.cacheCoins.find(outpoint);
+    bool fHave = (it != shard.cacheCoins.end());
+    if (fHave)
+        fSpent = it->second.coin.IsSpent();
+    return fHave;
+}
+
+void CCoinsViewShardedCache::AddCoin(const COutPoint &outpoint, Coin &&coin, bool possible_overwrite)
+{
+    assert(!coin.IsSpent());
+    if (coin.out.scriptPubKey.IsUnspendable())
+        return;
+    Shard &shard = GetShard(outpoint);
+    WRITELOCK(shard.cs_shard);
+    CCoinsMap::iterator it;
+    bool inserted;
+    std::tie(it, inserted) =
+        shard.cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
+    bool fresh = false;
+    if (!inserted)
+    {
+        shard.cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+    }
+    if (!possible_overwrite)
+    {
+        if (!it->second.coin.IsSpent())
+        {
+            throw std::logic_error("Adding new coin that replaces non-pruned entry");
+        }
+        fresh = !(it->second.flags & CCoinsCacheEntry::DIRTY);
+    }
+    it->second.coin = std::move(coin);
+    it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
+    shard.cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    UpdateBestCoinHeight(it->second.coin.nHeight);
+}
+
+void CCoinsViewShardedCache::SpendCoin(const COutPoint &outpoint, Coin *moveout)
+{
+    Shard &shard = GetShard(outpoint);
+    WRITELOCK(shard.cs_shard);
+    CCoinsMap::iterator it = FetchCoin(shard, outpoint);
+    if (it == shard.cacheCoins.end())
+        return;
+    shard.cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+    if (moveout)
+    {
+        *moveout = std::move(it->second.coin);
+    }
+    if (it->second.flags & CCoinsCacheEntry::FRESH)
+    {
+        shard.cacheCoins.erase(it);
+    }
+    else
+    {
+        it->second.flags |= CCoinsCacheEntry::DIRTY;
+        it->second.coin.Clear();
+    }
+}
+
+uint256 CCoinsViewShardedCache::_GetBestBlock() const
+{
+    if (hashBlock.IsNull())
+        hashBlock = base->GetBestBlock();
+    return hashBlock;
+}
+
+void CCoinsViewShardedCache::SetBestBlock(const uint256 &hashBlockIn)
+{
+    WRITELOCK(cs_utxo);
+    hashBlock = hashBlockIn;
+}
+
+bool CCoinsViewShardedCache::BatchWrite(CCoinsMap &mapCoins,
+    const uint256 &hashBlockIn,
+    const uint64_t nBestCoinHeightIn,
+    size_t &nChildCachedCoinsUsage)
+{
+    // Sort the dirty entries by shard first so that each shard is only locked once.
+    std::vector<std::vector<CCoinsMap::iterator> > vByShard(vShards.size());
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it++)
+    {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY)
+            vByShard[hasher(it->first) % vShards.size()].push_back(it);
+    }
+
+    for (size_t i = 0; i < vShards.size(); i++)
+    {
+        if (vByShard[i].empty())
+            continue;
+        Shard &shard = *vShards[i];
+        WRITELOCK(shard.cs_shard);
+        for (CCoinsMap::iterator it : vByShard[i])
+        {
+            nChildCachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+
+            CCoinsMap::iterator itUs = shard.cacheCoins.find(it->first);
+            if (itUs == shard.cacheCoins.end())
+            {
+                // The parent cache does not have an entry, while the child does.  We can ignore it if it's both
+                // FRESH and pruned in the child, otherwise it is moved up and marked dirty (and FRESH if it was
+                // FRESH in the child).
+                if (!(it->second.flags & CCoinsCacheEntry::FRESH && it->second.coin.IsSpent()))
+                {
+                    CCoinsCacheEntry &entry = shard.cacheCoins[it->first];
+                    entry.coin = std::move(it->second.coin);
+                    shard.cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
+                    entry.flags = CCoinsCacheEntry::DIRTY;
+                    if (it->second.flags & CCoinsCacheEntry::FRESH)
+                        entry.flags |= CCoinsCacheEntry::FRESH;
+                }
+            }
+            else
+            {
+                // See CCoinsViewCache::BatchWrite
+                if ((it->second.flags & CCoinsCacheEntry::FRESH) && !itUs->second.coin.IsSpent())
+                    throw std::logic_error(
+                        "FRESH flag misapplied to cache entry for base transaction with spendable outputs");
+
+                shard.cachedCoinsUsage -= itUs->second.coin.DynamicMemoryUsage();
+                if ((itUs->second.flags & CCoinsCacheEntry::FRESH) && it->second.coin.IsSpent())
+                {
+                    shard.cacheCoins.erase(itUs);
+                }
+                else
+                {
+                    itUs->second.coin = std::move(it->second.coin);
+                    shard.cachedCoinsUsage += itUs->second.coin.DynamicMemoryUsage();
+                    itUs->second.flags |= CCoinsCacheEntry::DIRTY;
+                }
+            }
+            mapCoins.erase(it);
+        }
+    }
+
+    {
+        WRITELOCK(cs_utxo);
+        hashBlock = hashBlockIn;
+    }
+    UpdateBestCoinHeight(nBestCoinHeightIn);
+    return true;
+}
+
+bool CCoinsViewShardedCache::Flush()
+{
+    WRITELOCK(cs_utxo);
+    // Lock the shards in order, which is the only place more than one is held at a time.
+    std::vector<std::unique_ptr<CWriteBlock> > vLocks;
+    for (auto &shard : vShards)
+        vLocks.emplace_back(new CWriteBlock(shard->cs_shard, "cs_shard", __FILE__, __LINE__, LockType::SHARED_MUTEX));
+
+    // Gather the dirty entries into one map so that the base gets them, and the best block, as a single batch.
+    CCoinsMap mapDirty;
+    size_t nDirtyUsage = 0;
+    for (auto &shard : vShards)
+    {
+        for (CCoinsMap::iterator it = shard->cacheCoins.begin(); it != shard->cacheCoins.end();)
+        {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY)
+            {
+                size_t nUsage = it->second.coin.DynamicMemoryUsage();
+                shard->cachedCoinsUsage -= nUsage;
+                nDirtyUsage += nUsage;
+                mapDirty.emplace(it->first, std::move(it->second));
+                it = shard->cacheCoins.erase(it);
+            }
+            else
+                it++;
+        }
+    }
+    bool fOk = base->BatchWrite(mapDirty, _GetBestBlock(), nBestCoinHeight.load(), nDirtyUsage);
+
+    // The base may leave written entries in the map for us to keep caching
+    for (auto &item : mapDirty)
+    {
+        Shard &shard = GetShard(item.first);
+        shard.cachedCoinsUsage += item.second.coin.DynamicMemoryUsage();
+        shard.cacheCoins.emplace(item.first, std::move(item.second));
+    }
+    return fOk;
+}
+
+void CCoinsViewShardedCache::Trim(size_t nTrimSize) const
+{
+    const size_t nShardTrimSize = nTrimSize / vShards.size();
+    uint64_t nTrimmed = 0;
+    for (auto &shard : vShards)
+    {
+        WRITELOCK(shard->cs_shard);
+        CCoinsMap::iterator iter = shard->cacheCoins.begin();
+        while (iter != shard->cacheCoins.end() &&
+               memusage::DynamicUsage(shard->cacheCoins) + shard->cachedCoinsUsage > nShardTrimSize)
+        {
+            // Only erase entries that have not been modified
+            if (iter->second.flags == 0)
+            {
+                shard->cachedCoinsUsage -= iter->second.coin.DynamicMemoryUsage();
+                iter = shard->cacheCoins.erase(iter);
+                nTrimmed++;
+            }
+            else
+                iter++;
+        }
+    }
+    if (nTrimmed > 0)
+        LOG(COINDB, "Trimmed %ld from the sharded coins cache\n", nTrimmed);
+}
+
+void CCoinsViewShardedCache::Uncache(const COutPoint &outpoint)
+{
+    Shard &shard = GetShard(outpoint);
+    WRITELOCK(shard.cs_shard);
+    CCoinsMap::iterator it = shard.cacheCoins.find(outpoint);
+
+    // only uncache coins that are not dirty.
+    if (it != shard.cacheCoins.end() && it->second.flags == 0)
+    {
+        shard.cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+        shard.cacheCoins.erase(it);
+    }
+}
+
+unsigned int CCoinsViewShardedCache::GetCacheSize() const
+{
+    unsigned int nSize = 0;
+    for (auto &shard : vShards)
+    {
+        READLOCK(shard->cs_shard);
+        nSize += shard->cacheCoins.size();
+    }
+    return nSize;
+}
+
+size_t CCoinsViewShardedCache::DynamicMemoryUsage() const
+{
+    size_t nUsage = 0;
+    for (auto &shard : vShards)
+    {
+        READLOCK(shard->cs_shard);
+        nUsage += memusage::DynamicUsage(shard->cacheCoins) + shard->cachedCoinsUsage;
+    }
+    return nUsage;
+}
+
 CCoinsViewCursor::~CCoinsViewCursor() {}
 static const size_t nMaxOutputsPerBlock =
     DEFAULT_LARGEST_TRANSACTION / ::GetSerializeSize(CTxOut(), SER_NETWORK, PROTOCOL_VERSION);
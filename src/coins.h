@@ -21,7 +21,11 @@
 #include <boost/thread/locks.hpp>
 #include <boost/thread/shared_mutex.hpp>
 
+#include <atomic>
+#include <map>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 class CTxUndo;
 class CValidationState;
@@ -104,6 +108,27 @@ public:
     size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(out.scriptPubKey); }
 };
 
+/**
+ * Accumulates the statistics and the serialized hash of gettxoutsetinfo over an unspent output set.  Coins must be
+ * added in database order, that is with all the outputs of a transaction together.
+ */
+class CCoinsStatsHasher
+{
+private:
+    CCoinsStats &stats;
+    CHashWriter ss;
+    uint256 prevkey;
+    std::map<uint32_t, Coin> outputs;
+
+    void ApplyStats();
+
+public:
+    CCoinsStatsHasher(CCoinsStats &statsIn, const uint256 &hashBlock);
+    void Add(const COutPoint &key, Coin &&coin);
+    /** Sets and returns stats.hashSerialized once every coin has been added */
+    uint256 Finalize();
+};
+
 class SaltedOutpointHasher
 {
 private:
@@ -407,6 +432,93 @@ protected:
     CCoinsViewCache(const CCoinsViewCache &);
 };
 
+/**
+ * CCoinsView that adds a memory cache to another CCoinsView, like CCoinsViewCache, but with the cache split into
+ * independent partitions by outpoint.  Each partition has its own lock and memory accounting so that threads working
+ * on different outpoints do not contend with one another.  Coins are returned by value since no lock is held once a
+ * call returns.
+ */
+class CCoinsViewShardedCache : public CCoinsViewBacked
+{
+public:
+    static const unsigned int DEFAULT_SHARDS = 16;
+
+protected:
+    struct Shard
+    {
+        mutable CSharedCriticalSection cs_shard;
+        mutable CCoinsMap cacheCoins;
+        /* Cached dynamic memory usage for the inner Coin objects of this shard. */
+        mutable size_t cachedCoinsUsage;
+
+        Shard() : cachedCoinsUsage(0) {}
+    };
+
+    /** Picks the shard of an outpoint.  Salted separately from the maps so that it does not bias their buckets. */
+    const SaltedOutpointHasher hasher;
+    std::vector<std::unique_ptr<Shard> > vShards;
+
+    /** The best block, protected by cs_utxo */
+    mutable uint256 hashBlock;
+    mutable std::atomic<uint64_t> nBestCoinHeight;
+
+public:
+    CCoinsViewShardedCache(CCoinsView *baseIn, unsigned int nShards = DEFAULT_SHARDS);
+
+    // Standard CCoinsView methods
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 _GetBestBlock() const override;
+    void SetBestBlock(const uint256 &hashBlock);
+    bool BatchWrite(CCoinsMap &mapCoins,
+        const uint256 &hashBlock,
+        const uint64_t nBestCoinHeight,
+        size_t &nChildCachedCoinsUsage) override;
+
+    /** Return a copy of the coin, or a spent one if it is not found. */
+    Coin AccessCoin(const COutPoint &outpoint) const;
+
+    /** Check if we have the given utxo already loaded in this cache. fSpent is only set if it is. */
+    bool HaveCoinInCache(const COutPoint &outpoint, bool &fSpent) const;
+
+    /** Add a coin. Set potential_overwrite to true if a non-pruned version may already exist. */
+    void AddCoin(const COutPoint &outpoint, Coin &&coin, bool potential_overwrite);
+
+    /**
+     * Spend a coin. Pass moveto in order to get the deleted data.
+     * If no unspent output exists for the passed outpoint, this call has no effect.
+     */
+    void SpendCoin(const COutPoint &outpoint, Coin *moveto = nullptr);
+
+    /**
+     * Push the modifications applied to this cache to its base in one batch.  All the shards are locked while this
+     * is done so that the base sees a consistent state.
+     */
+    bool Flush();
+
+    /** Remove unmodified entries from each shard until the whole cache fits in nTrimSize bytes. */
+    void Trim(size_t nTrimSize) const;
+
+    /** Removes the UTXO with the given outpoint from the cache, if it is not modified. */
+    void Uncache(const COutPoint &outpoint);
+
+    //! Calculate the size of the cache (in number of transaction outputs)
+    unsigned int GetCacheSize() const;
+
+    //! Calculate the size of the cache (in bytes)
+    size_t DynamicMemoryUsage() const;
+
+    unsigned int ShardCount() const { return vShards.size(); }
+protected:
+    Shard &GetShard(const COutPoint &outpoint) const { return *vShards[hasher(outpoint) % vShards.size()]; }
+    // Find the coin in the shard, loading it from the base if need be. The shard must be write locked.
+    CCoinsMap::iterator FetchCoin(Shard &shard, const COutPoint &outpoint) const;
+    void UpdateBestCoinHeight(uint64_t nHeight) const;
+
+private:
+    CCoinsViewShardedCache(const CCoinsViewShardedCache &);
+};
+
 //! Utility function to add all of a transaction's outputs to a cache.
 // It assumes that overwrites are only possible for coinbase transactions,
 // TODO: pass in a boolean to limit these possible overwrites to known
@@ -0,0 +1,93 @@
+// Copyright (c) 2015-2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinsflatmap.h"
+
+#include <assert.h>
+
+const uint32_t CCoinsFlatMap::EMPTY;
+const size_t CCoinsFlatMap::MIN_SLOTS;
+
+void CCoinsFlatMap::Rehash(size_t nSlots)
+{
+    assert((nSlots & (nSlots - 1)) == 0);
+    assert(entries.size() * 4 <= nSlots * 3);
+    slots.assign(nSlots, Slot{EMPTY, 0});
+    slots.shrink_to_fit();
+    mask = nSlots - 1;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        uint32_t hash = Hash(entries[i].first);
+        size_t pos = hash & mask;
+        while (slots[pos].index != EMPTY)
+            pos = (pos + 1) & mask;
+        slots[pos] = Slot{(uint32_t)i, hash};
+    }
+}
+
+void CCoinsFlatMap::EraseSlot(size_t pos)
+{
+    uint32_t index = slots[pos].index;
+
+    // Backward shift deletion: pull forward any entry in the probe run that follows pos and whose home slot is not
+    // in between, so that lookups never need tombstones.
+    size_t hole = pos;
+    size_t next = (hole + 1) & mask;
+    while (slots[next].index != EMPTY)
+    {
+        size_t home = slots[next].hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    slots[hole].index = EMPTY;
+
+    // Keep the arena dense by moving its last entry into the freed position and repointing that entry's slot.
+    uint32_t last = entries.size() - 1;
+    if (index != last)
+    {
+        size_t lastPos = Probe(entries[last].first, Hash(entries[last].first));
+        assert(slots[lastPos].index == last);
+        slots[lastPos].index = index;
+        entries[index] = std::move(entries[last]);
+    }
+    entries.pop_back();
+}
+
+CCoinsFlatMap::iterator CCoinsFlatMap::erase(iterator it)
+{
+    size_t index = it - entries.begin();
+    EraseSlot(Probe(it->first, Hash(it->first)));
+    return entries.begin() + index;
+}
+
+size_t CCoinsFlatMap::erase(const COutPoint &outpoint)
+{
+    size_t pos = Probe(outpoint, Hash(outpoint));
+    if (slots[pos].index == EMPTY)
+        return 0;
+    EraseSlot(pos);
+    return 1;
+}
+
+void CCoinsFlatMap::clear()
+{
+    std::vector<value_type>().swap(entries);
+    slots.assign(MIN_SLOTS, Slot{EMPTY, 0});
+    slots.shrink_to_fit();
+    mask = MIN_SLOTS - 1;
+}
+
+void CCoinsFlatMap::reserve(size_t n)
+{
+    entries.reserve(n);
+    size_t nSlots = slots.size();
+    while (n * 4 > nSlots * 3)
+        nSlots *= 2;
+    if (nSlots != slots.size())
+        Rehash(nSlots);
+}
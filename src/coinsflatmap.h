@@ -0,0 +1,135 @@
+// Copyright (c) 2015-2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSFLATMAP_H
+#define BITCOIN_COINSFLATMAP_H
+
+#include "coins.h"
+#include "memusage.h"
+
+#include <stdint.h>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * An open addressing alternative to CCoinsMap.
+ *
+ * The entries live contiguously in a single arena (a vector) and the hash table is a flat array of small slots,
+ * each holding the arena index of an entry plus the low 32 bits of its hash.  Probing is linear and compares the
+ * stored hash bits before touching the entry, so a lookup touches one cache line of the table and, on a hit, one
+ * entry of the arena.  There is no per entry allocation, which removes the node and bucket overhead that
+ * std::unordered_map carries for every coin and makes DynamicMemoryUsage() exact.
+ *
+ * Erasing an entry moves the last entry of the arena into its place, and growing the arena may reallocate it, so
+ * unlike CCoinsMap any insert or erase invalidates all iterators and references into the map.
+ */
+class CCoinsFlatMap
+{
+public:
+    typedef COutPoint key_type;
+    typedef CCoinsCacheEntry mapped_type;
+    typedef std::pair<COutPoint, CCoinsCacheEntry> value_type;
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+private:
+    struct Slot
+    {
+        uint32_t index;
+        uint32_t hash;
+    };
+    static const uint32_t EMPTY = 0xffffffff;
+    static const size_t MIN_SLOTS = 16;
+
+    SaltedOutpointHasher hasher;
+    std::vector<value_type> entries;
+    std::vector<Slot> slots;
+    size_t mask;
+
+    uint32_t Hash(const COutPoint &outpoint) const { return (uint32_t)hasher(outpoint); }
+    /** Return the slot holding outpoint, or the empty slot where it would be inserted */
+    size_t Probe(const COutPoint &outpoint, uint32_t hash) const
+    {
+        size_t pos = hash & mask;
+        while (true)
+        {
+            const Slot &slot = slots[pos];
+            if (slot.index == EMPTY || (slot.hash == hash && entries[slot.index].first == outpoint))
+                return pos;
+            pos = (pos + 1) & mask;
+        }
+    }
+    /** Resize the table to nSlots (a power of two) and reinsert every entry */
+    void Rehash(size_t nSlots);
+    /** Remove the entry referenced by table slot pos */
+    void EraseSlot(size_t pos);
+
+public:
+    CCoinsFlatMap() : slots(MIN_SLOTS, Slot{EMPTY, 0}), mask(MIN_SLOTS - 1) {}
+
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    iterator find(const COutPoint &outpoint)
+    {
+        const Slot &slot = slots[Probe(outpoint, Hash(outpoint))];
+        return slot.index == EMPTY ? entries.end() : entries.begin() + slot.index;
+    }
+    const_iterator find(const COutPoint &outpoint) const
+    {
+        const Slot &slot = slots[Probe(outpoint, Hash(outpoint))];
+        return slot.index == EMPTY ? entries.end() : entries.begin() + slot.index;
+    }
+    size_t count(const COutPoint &outpoint) const { return find(outpoint) != end(); }
+
+    /** Insert an entry if outpoint is not present.  Returns the entry and whether it was inserted. */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const COutPoint &outpoint, Args &&... args)
+    {
+        uint32_t hash = Hash(outpoint);
+        size_t pos = Probe(outpoint, hash);
+        if (slots[pos].index != EMPTY)
+            return std::make_pair(entries.begin() + slots[pos].index, false);
+        // keep the load factor at or below 3/4
+        if ((entries.size() + 1) * 4 > slots.size() * 3)
+        {
+            Rehash(slots.size() * 2);
+            pos = Probe(outpoint, hash);
+        }
+        slots[pos] = Slot{(uint32_t)entries.size(), hash};
+        entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(outpoint),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        return std::make_pair(entries.end() - 1, true);
+    }
+    std::pair<iterator, bool> insert(value_type &&value)
+    {
+        return emplace(value.first, std::move(value.second));
+    }
+    CCoinsCacheEntry &operator[](const COutPoint &outpoint) { return emplace(outpoint).first->second; }
+
+    /** Erase the entry at it.  Returns an iterator to the entry that now occupies its position. */
+    iterator erase(iterator it);
+    size_t erase(const COutPoint &outpoint);
+    void clear();
+    /** Size the arena and table so that n entries can be held without reallocating */
+    void reserve(size_t n);
+
+    /** Exact heap usage of the arena and table, not including the dynamic usage of the coins themselves */
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(entries) + memusage::DynamicUsage(slots);
+    }
+};
+
+namespace memusage
+{
+static inline size_t DynamicUsage(const CCoinsFlatMap &m) { return m.DynamicMemoryUsage(); }
+}
+
+#endif // BITCOIN_COINSFLATMAP_H
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "merkle.h"
+#include "crypto/sha256.h"
 #include "hashwrapper.h"
 #include "utilstrencodings.h"
 
@@ -163,11 +164,55 @@ static void MerkleComputation(const std::vector<uint256> &leaves,
         *proot = h;
 }
 
-uint256 ComputeMerkleRoot(const std::vector<uint256> &leaves, bool *mutated)
+uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool *mutated)
 {
-    uint256 hash;
-    MerkleComputation(leaves, &hash, mutated, -1, nullptr);
-    return hash;
+    // Compute the tree a level at a time, in place, so that all the hashes of a level are done in one go
+    // by SHA256D64, which can do several of them at once on CPUs that support it.
+    bool mutation = false;
+    while (hashes.size() > 1)
+    {
+        if (mutated)
+        {
+            for (size_t pos = 0; pos + 1 < hashes.size(); pos += 2)
+            {
+                if (hashes[pos] == hashes[pos + 1])
+                    mutation = true;
+            }
+        }
+        if (hashes.size() & 1)
+            hashes.push_back(hashes.back());
+        SHA256D64(hashes[0].begin(), hashes[0].begin(), hashes.size() / 2);
+        hashes.resize(hashes.size() / 2);
+    }
+    if (mutated)
+        *mutated = mutation;
+    if (hashes.size() == 0)
+        return uint256();
+    return hashes[0];
+}
+
+void ComputeMerkleSubtree(uint256 *hashes, size_t count, int levels, bool *mutated)
+{
+    bool mutation = false;
+    for (int level = 0; level < levels; level++)
+    {
+        for (size_t pos = 0; pos + 1 < count; pos += 2)
+        {
+            if (hashes[pos] == hashes[pos + 1])
+                mutation = true;
+        }
+        size_t pairs = count / 2;
+        SHA256D64(hashes[0].begin(), hashes[0].begin(), pairs);
+        // There is no room to duplicate an odd hash out at the end, so it is hashed with itself on its own.
+        if (count & 1)
+        {
+            const uint256 &last = hashes[count - 1];
+            CHash256().Write(last.begin(), 32).Write(last.begin(), 32).Finalize(hashes[pairs].begin());
+        }
+        count = pairs + (count & 1);
+    }
+    if (mutated)
+        *mutated = mutation;
 }
 
 std::vector<uint256> ComputeMerkleBranch(const std::vector<uint256> &leaves, uint32_t position)
@@ -203,7 +248,7 @@ uint256 BlockMerkleRoot(const CBlock &block, bool *mutated)
     {
         leaves[s] = block.vtx[s]->GetHash();
     }
-    return ComputeMerkleRoot(leaves, mutated);
+    return ComputeMerkleRoot(std::move(leaves), mutated);
 }
 
 std::vector<uint256> BlockMerkleBranch(const CBlock &block, uint32_t position)
@@ -13,7 +13,15 @@
 #include "primitives/transaction.h"
 #include "uint256.h"
 
-uint256 ComputeMerkleRoot(const std::vector<uint256> &leaves, bool *mutated = nullptr);
+uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool *mutated = nullptr);
+
+/*
+ * Compute, in place, the root of a subtree of a merkle tree that is levels levels high.  hashes holds the count
+ * leaves of the subtree and the root is left in hashes[0].  Only the rightmost subtree of a tree may have fewer
+ * than 2^levels leaves; it is completed the same way ComputeMerkleRoot completes the tree.
+ * *mutated is set to true if a duplicated subtree was found.
+ */
+void ComputeMerkleSubtree(uint256 *hashes, size_t count, int levels, bool *mutated = nullptr);
 
 /*
 To compute a merkle path (AKA merkle proof), pass the index of the element being proved into position.
@@ -0,0 +1,181 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <string.h>
+
+const int Num3072::LIMB_SIZE;
+const int Num3072::LIMBS;
+const size_t Num3072::BYTE_SIZE;
+const Num3072::limb_t Num3072::MAX_PRIME_DIFF;
+const size_t MuHash3072::SERIALIZED_SIZE;
+
+Num3072::Num3072(const unsigned char data[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        limbs[i] = 0;
+        for (size_t b = 0; b < sizeof(limb_t); ++b) {
+            limbs[i] |= (limb_t)data[i * sizeof(limb_t) + b] << (8 * b);
+        }
+    }
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; ++i) {
+        limbs[i] = 0;
+    }
+}
+
+bool Num3072::IsOverflow() const
+{
+    // The modulus is all ones except for its lowest limb, which is 2^LIMB_SIZE - MAX_PRIME_DIFF.
+    for (int i = 1; i < LIMBS; ++i) {
+        if (limbs[i] != (limb_t)~(limb_t)0) return false;
+    }
+    return limbs[0] >= (limb_t)((limb_t)0 - MAX_PRIME_DIFF);
+}
+
+void Num3072::FullReduce()
+{
+    // Subtract the modulus by adding MAX_PRIME_DIFF and dropping the carry out of the top limb.
+    limb_t carry = MAX_PRIME_DIFF;
+    for (int i = 0; i < LIMBS && carry; ++i) {
+        limbs[i] += carry;
+        carry = limbs[i] < carry;
+    }
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    // Schoolbook product into twice as many limbs.  Every row fits its carry into one limb since
+    // (2^n - 1)^2 + 2 * (2^n - 1) < 2^2n.
+    limb_t t[2 * LIMBS];
+    memset(t, 0, sizeof(t));
+    for (int i = 0; i < LIMBS; ++i) {
+        limb_t carry = 0;
+        for (int j = 0; j < LIMBS; ++j) {
+            double_limb_t v = (double_limb_t)limbs[i] * a.limbs[j] + t[i + j] + carry;
+            t[i + j] = (limb_t)v;
+            carry = (limb_t)(v >> LIMB_SIZE);
+        }
+        t[i + LIMBS] = carry;
+    }
+
+    // As 2^3072 = MAX_PRIME_DIFF modulo the prime, the high half folds onto the low half multiplied by it.
+    limb_t carry = 0;
+    for (int j = 0; j < LIMBS; ++j) {
+        double_limb_t v = (double_limb_t)t[j + LIMBS] * MAX_PRIME_DIFF + t[j] + carry;
+        limbs[j] = (limb_t)v;
+        carry = (limb_t)(v >> LIMB_SIZE);
+    }
+    // Fold what overflowed the top limb the same way.  The second pass, if any, only carries out a single bit.
+    while (carry) {
+        double_limb_t v = (double_limb_t)carry * MAX_PRIME_DIFF;
+        for (int j = 0; j < LIMBS && v; ++j) {
+            v += limbs[j];
+            limbs[j] = (limb_t)v;
+            v >>= LIMB_SIZE;
+        }
+        carry = (limb_t)v;
+    }
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // By Fermat's little theorem the inverse is this^(p - 2).  All the limbs of p - 2 but the lowest are ones.
+    Num3072 out;
+    for (int i = LIMBS - 1; i >= 0; --i) {
+        limb_t e = i ? (limb_t)~(limb_t)0 : (limb_t)((limb_t)0 - MAX_PRIME_DIFF - 2);
+        for (int b = LIMB_SIZE - 1; b >= 0; --b) {
+            out.Multiply(out);
+            if ((e >> b) & 1) out.Multiply(*this);
+        }
+    }
+    return out;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+void Num3072::ToBytes(unsigned char out[BYTE_SIZE])
+{
+    if (IsOverflow()) FullReduce();
+    for (int i = 0; i < LIMBS; ++i) {
+        for (size_t b = 0; b < sizeof(limb_t); ++b) {
+            out[i * sizeof(limb_t) + b] = (unsigned char)(limbs[i] >> (8 * b));
+        }
+    }
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    // Expand the SHA256 of the element to 3072 bits by hashing it with a counter.
+    unsigned char key[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(key);
+    unsigned char expanded[Num3072::BYTE_SIZE];
+    for (uint32_t i = 0; i < Num3072::BYTE_SIZE / CSHA256::OUTPUT_SIZE; ++i) {
+        unsigned char counter[4];
+        WriteLE32(counter, i);
+        CSHA256 hasher;
+        hasher.Write(key, sizeof(key)).Write(counter, sizeof(counter));
+        hasher.Finalize(expanded + i * CSHA256::OUTPUT_SIZE);
+    }
+    return Num3072(expanded);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char out[32])
+{
+    numerator.Divide(denominator);
+    denominator.SetToOne();
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    numerator.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(out);
+}
+
+void MuHash3072::GetBytes(unsigned char out[SERIALIZED_SIZE])
+{
+    numerator.ToBytes(out);
+    denominator.ToBytes(out + Num3072::BYTE_SIZE);
+}
+
+void MuHash3072::SetBytes(const unsigned char in[SERIALIZED_SIZE])
+{
+    numerator = Num3072(in);
+    denominator = Num3072(in + Num3072::BYTE_SIZE);
+}
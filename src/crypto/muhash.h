@@ -0,0 +1,81 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** An integer modulo the prime 2^3072 - 1103717, kept in little endian limbs and not always fully reduced. */
+class Num3072
+{
+public:
+#ifdef __SIZEOF_INT128__
+    typedef uint64_t limb_t;
+    typedef unsigned __int128 double_limb_t;
+#else
+    typedef uint32_t limb_t;
+    typedef uint64_t double_limb_t;
+#endif
+    static const int LIMB_SIZE = 8 * sizeof(limb_t);
+    static const int LIMBS = 3072 / LIMB_SIZE;
+    static const size_t BYTE_SIZE = 384;
+    /** 2^3072 - MAX_PRIME_DIFF is the largest prime below 2^3072 */
+    static const limb_t MAX_PRIME_DIFF = 1103717;
+
+    limb_t limbs[LIMBS];
+
+    Num3072() { SetToOne(); }
+    explicit Num3072(const unsigned char data[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    Num3072 GetInverse() const;
+    /** Write the fully reduced value as little endian bytes */
+    void ToBytes(unsigned char out[BYTE_SIZE]);
+
+private:
+    bool IsOverflow() const;
+    void FullReduce();
+};
+
+/**
+ * A rolling hash of a set of byte strings, in which elements can be added and removed in any order and two sets with
+ * the same elements always hash the same.  Each element is expanded to a number modulo a 3072 bit prime, and the
+ * hash is the SHA256 of the product of the added elements divided by the product of the removed ones.
+ *
+ * Additions and removals are kept in separate products so that each costs a single multiplication; the one modular
+ * inversion is left to Finalize.  Two MuHash3072 can be combined with *= and /= as if their elements had been added
+ * to (or removed from) a single one, which lets disjoint parts of a set be hashed in parallel.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    static const size_t SERIALIZED_SIZE = 2 * Num3072::BYTE_SIZE;
+
+    /** The hash of the empty set */
+    MuHash3072() {}
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+    MuHash3072& operator*=(const MuHash3072& mul);
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /** Write the 32 byte hash of the set.  The state is left reduced but otherwise equivalent. */
+    void Finalize(unsigned char out[32]);
+
+    /** The state as bytes, for storing it and restoring it with SetBytes */
+    void GetBytes(unsigned char out[SERIALIZED_SIZE]);
+    void SetBytes(const unsigned char in[SERIALIZED_SIZE]);
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
@@ -0,0 +1,170 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// SHA-256 using the Intel SHA extensions, following Intel's reference code. The state is kept in the
+// ABEF/CDGH layout that the sha256rnds2 instruction works on.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace {
+
+alignas(16) const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+alignas(16) const uint32_t INIT[8] = {
+    0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul};
+
+/** Byte shuffle that turns 4 big endian words into native ones, and back. */
+alignas(16) const uint8_t MASK[16] = {0x03, 0x02, 0x01, 0x00, 0x07, 0x06, 0x05, 0x04, 0x0b, 0x0a, 0x09, 0x08, 0x0f, 0x0e, 0x0d, 0x0c};
+
+/** Four rounds, using the 4 message words in m and the 4 round constants starting at K256[4 * n]. */
+void inline __attribute__((always_inline)) QuadRound(__m128i& state0, __m128i& state1, __m128i m, int n)
+{
+    const __m128i msg = _mm_add_epi32(m, _mm_load_si128((const __m128i*)&K256[4 * n]));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+/** Compute the next 4 message words into m0, given that m0..m3 hold the previous 16 oldest first. */
+void inline __attribute__((always_inline)) ShiftMessage(__m128i& m0, __m128i m1, __m128i m2, __m128i m3)
+{
+    m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), _mm_alignr_epi8(m3, m2, 4)), m3);
+}
+
+/** Turn a DCBA, HGFE state into ABEF, CDGH. */
+void inline __attribute__((always_inline)) Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+/** Turn an ABEF, CDGH state back into DCBA, HGFE. */
+void inline __attribute__((always_inline)) Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+__m128i inline __attribute__((always_inline)) Load(const unsigned char* in)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), _mm_load_si128((const __m128i*)MASK));
+}
+
+void inline __attribute__((always_inline)) Save(unsigned char* out, __m128i s)
+{
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(s, _mm_load_si128((const __m128i*)MASK)));
+}
+
+/**
+ * Transform N independent states, each by one block whose message words are in m. The N computations are
+ * interleaved so that the latency of one hides behind the others.
+ */
+template <int N>
+void inline __attribute__((always_inline)) Compress(__m128i (&s0)[N], __m128i (&s1)[N], __m128i (&m)[N][4])
+{
+    __m128i so0[N], so1[N];
+    for (int j = 0; j < N; j++) {
+        so0[j] = s0[j];
+        so1[j] = s1[j];
+    }
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < N; j++) {
+            if (i >= 4) ShiftMessage(m[j][i & 3], m[j][(i + 1) & 3], m[j][(i + 2) & 3], m[j][(i + 3) & 3]);
+            QuadRound(s0[j], s1[j], m[j][i & 3], i);
+        }
+    }
+    for (int j = 0; j < N; j++) {
+        s0[j] = _mm_add_epi32(s0[j], so0[j]);
+        s1[j] = _mm_add_epi32(s1[j], so1[j]);
+    }
+}
+
+/** Double-SHA256 of N 64-byte inputs. */
+template <int N>
+void inline __attribute__((always_inline)) TransformD64(unsigned char* out, const unsigned char* in)
+{
+    __m128i s0[N], s1[N], m[N][4];
+    __m128i init0 = _mm_load_si128((const __m128i*)INIT);
+    __m128i init1 = _mm_load_si128((const __m128i*)(INIT + 4));
+    Shuffle(init0, init1);
+
+    // The first hash: the 64 bytes of input, followed by a block of padding.
+    for (int j = 0; j < N; j++) {
+        s0[j] = init0;
+        s1[j] = init1;
+        for (int i = 0; i < 4; i++) m[j][i] = Load(in + 64 * j + 16 * i);
+    }
+    Compress<N>(s0, s1, m);
+    for (int j = 0; j < N; j++) {
+        m[j][0] = _mm_set_epi32(0, 0, 0, 0x80000000ul);
+        m[j][1] = _mm_setzero_si128();
+        m[j][2] = _mm_setzero_si128();
+        m[j][3] = _mm_set_epi32(512, 0, 0, 0);
+    }
+    Compress<N>(s0, s1, m);
+
+    // The second hash: the 32 byte result of the first, and its padding, in one block.
+    for (int j = 0; j < N; j++) {
+        Unshuffle(s0[j], s1[j]);
+        m[j][0] = s0[j];
+        m[j][1] = s1[j];
+        m[j][2] = _mm_set_epi32(0, 0, 0, 0x80000000ul);
+        m[j][3] = _mm_set_epi32(256, 0, 0, 0);
+        s0[j] = init0;
+        s1[j] = init1;
+    }
+    Compress<N>(s0, s1, m);
+
+    for (int j = 0; j < N; j++) {
+        Unshuffle(s0[j], s1[j]);
+        Save(out + 32 * j, s0[j]);
+        Save(out + 32 * j + 16, s1[j]);
+    }
+}
+
+}
+
+namespace sha256_shani {
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0[1], s1[1], m[1][4];
+    s0[0] = _mm_loadu_si128((const __m128i*)s);
+    s1[0] = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0[0], s1[0]);
+
+    while (blocks--) {
+        for (int i = 0; i < 4; i++) m[0][i] = Load(chunk + 16 * i);
+        Compress<1>(s0, s1, m);
+        chunk += 64;
+    }
+
+    Unshuffle(s0[0], s1[0]);
+    _mm_storeu_si128((__m128i*)s, s0[0]);
+    _mm_storeu_si128((__m128i*)(s + 4), s1[0]);
+}
+}
+
+namespace sha256d64_shani {
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    TransformD64<2>(out, in);
+}
+}
+
+#endif
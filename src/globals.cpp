@@ -26,6 +26,7 @@
 #include "main.h"
 #include "miner.h"
 #include "netbase.h"
+#include "netbufferpool.h"
 #include "nodestate.h"
 #include "policy/policy.h"
 #include "primitives/block.h"
@@ -222,15 +223,9 @@ CDoSManager dosMan;
 
 // Transaction mempool admission globals
 
-// Transactions that are available to be added to the mempool, and protection
+// Protects the queues of transactions that are not on the input queue of an admission thread.  The input queues
+// themselves belong to the admission threads (see txadmission.cpp).
 CCriticalSection csTxInQ;
-CCond cvTxInQ;
-
-// Finds transactions that may conflict with other pending transactions
-CFastFilter<4 * 1024 * 1024> incomingConflicts GUARDED_BY(csTxInQ);
-
-// Tranactions that are waiting for validation and are known not to conflict with others
-std::queue<CTxInputData> txInQ GUARDED_BY(csTxInQ);
 
 // Transaction that cannot be processed in this round (may potentially conflict with other tx)
 std::queue<CTxInputData> txDeferQ GUARDED_BY(csTxInQ);
@@ -242,13 +237,9 @@ std::queue<CTxInputData> txWaitNextBlockQ GUARDED_BY(csTxInQ);
 ;
 
 // Transactions that have been validated and are waiting to be committed into the mempool
+CTxCommitQueue txCommitQ;
 CWaitableCriticalSection csCommitQ;
 CConditionVariable cvCommitQ GUARDED_BY(csCommitQ);
-std::map<uint256, CTxCommitData> *txCommitQ GUARDED_BY(csCommitQ) = nullptr;
-// Before the transactions are finally commited to the mempool the txCommitQ pointer is copied
-// to txCommitQFinal so that the lock on txCommitQ can be released and processing can continue.
-CCriticalSection csCommitQFinal;
-std::map<uint256, CTxCommitData> *txCommitQFinal GUARDED_BY(csCommitQFinal) = nullptr;
 
 // Control the execution of the parallel tx validation and serial mempool commit phases
 CThreadCorral txProcessingCorral;
@@ -282,6 +273,13 @@ CTweakRef<bool> displayArchInSubver("net.displayArchInSubver",
     "Show box architecture, 32/64bit, in node user agent string (subver)",
     &fDisplayArchInSubver);
 
+CTweak<bool> schnorrBatchVerify("parallel.schnorrBatchVerify",
+    "Verify the Schnorr signatures of a block in batches rather than one at a time",
+    false);
+CTweak<bool> prefetchCoins("parallel.prefetchCoins",
+    "Load the coins that a block spends into the coins cache on the script check threads before validating it",
+    true);
+
 CTweak<bool> miningCPFP("mining.childPaysForParent",
     "If enabled then we will mine ancestor packages and allow child pays for parent.",
     true);
@@ -352,6 +350,9 @@ CTweakRef<bool> enableCanonicalTxOrder("consensus.enableCanonicalTxOrder",
     &fCanonicalTxsOrder);
 
 CTweak<unsigned int> numMsgHandlerThreads("net.msgHandlerThreads", "Max message handler threads", 0);
+CTweak<unsigned int> numSocketHandlerThreads("net.socketHandlerThreads",
+    "Number of threads that send and receive on peer sockets, each peer is pinned to one of them (0: auto)",
+    0);
 CTweak<unsigned int> numTxAdmissionThreads("net.txAdmissionThreads", "Max transaction mempool admission threads", 0);
 CTweak<unsigned int> unconfPushAction("net.unconfChainResendAction",
     "Action to take when this node thinks that a peer will now accept a previously unacceptable unconfirmed transaction"
@@ -469,12 +470,18 @@ CStatHistory<uint64_t> sendAmt;
 CStatHistory<uint64_t> nTxValidationTime("txValidationTime", STAT_OP_MAX | STAT_INDIVIDUAL);
 CCriticalSection cs_blockvalidationtime;
 CStatHistory<uint64_t> nBlockValidationTime("blockValidationTime", STAT_OP_MAX | STAT_INDIVIDUAL);
+CStatHistory<uint64_t> nPrefetchLoaded("prefetch/coinsLoaded");
+CStatHistory<uint64_t> nPrefetchCached("prefetch/coinsCached");
+CStatHistory<uint64_t> nPrefetchMissing("prefetch/coinsMissing");
+CStatHistory<uint64_t> nPrefetchTimeSaved("prefetch/timeSaved");
+CNetBufferPool netBufferPool;
 
 // Single classes for gather thin type block relay statistics
 CThinBlockData thindata;
 CGrapheneBlockData graphenedata;
 CCompactBlockData compactdata;
 ThinTypeRelay thinrelay;
+CRecentBlockCache recentblocks;
 CCriticalSection cs_mempoolsync;
 std::map<NodeId, CMempoolSyncState> mempoolSyncRequested GUARDED_BY(cs_mempoolsync);
 std::map<NodeId, CMempoolSyncState> mempoolSyncResponded GUARDED_BY(cs_mempoolsync);
@@ -40,12 +40,15 @@
 #include "rpc/server.h"
 #include "script/sigcache.h"
 #include "script/standard.h"
+#include "socketevents.h"
 #include "threadgroup.h"
 #include "torcontrol.h"
 #include "txadmission.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
+#include "utxosnapshot.h"
+#include "utxostats.h"
 #include "unlimited.h"
 #include "util.h"
 #include "utilmoneystr.h"
@@ -266,6 +269,7 @@ void Shutdown()
         {
             FlushStateToDisk();
         }
+        g_utxostats.reset();
         delete pcoinsTip;
         pcoinsTip = nullptr;
         delete pcoinscatcher;
@@ -744,13 +748,19 @@ bool AppInit2(Config &config, thread_group &threadGroup)
         undofile_chunk_size = undofile_chunk_size * 8;
     }
 
+    std::string strSocketBackend = GetArg("-socketbackend", DEFAULT_SOCKET_BACKEND);
+    if (!ParseSocketBackend(strSocketBackend, socketBackend))
+        return InitError(strprintf(_("Unsupported -socketbackend value: '%s'"), strSocketBackend));
+
     // Make sure enough file descriptors are available
     int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     int nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
-    // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    // Trim requested connection counts, to fit into system limitations.  Only select() is limited to FD_SETSIZE.
+    if (socketBackend == SocketBackend::SELECT)
+        nMaxConnections =
+            std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1011,6 +1021,15 @@ bool AppInit2(Config &config, thread_group &threadGroup)
     }
     LOGA("Using %d message handler threads\n", numMsgHandlerThreads.Value());
 
+    // Setup the number of threads that send and receive on peer sockets
+    if (numSocketHandlerThreads.Value() == 0)
+    {
+        // Socket I/O is mostly kernel copies so a quarter of the cores is enough to keep up with the message handlers.
+        int nThreads = std::max(std::min(GetNumCores() / 4, 8), 1);
+        numSocketHandlerThreads.Set(nThreads);
+    }
+    LOGA("Using %d socket handler threads\n", numSocketHandlerThreads.Value());
+
     // Setup the number of transaction mempool admission threads
     if (numTxAdmissionThreads.Value() == 0)
     {
@@ -1184,9 +1203,23 @@ bool AppInit2(Config &config, thread_group &threadGroup)
                     break;
                 }
 
+                // Bootstrap the chainstate from a UTXO snapshot if one is given and nothing has been synced yet
+                if (mapArgs.count("-loadutxosnapshot"))
+                {
+                    uiInterface.InitMessage(_("Loading UTXO snapshot..."));
+                    if (!LoadUTXOSnapshot(GetArg("-loadutxosnapshot", ""), uint256S(GetArg("-assumeutxohash", "")),
+                            chainparams))
+                    {
+                        return InitError(_("Unable to load the UTXO snapshot, see debug.log for details"));
+                    }
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
-                // in the past, but is now trying to run unpruned.
-                if (fHavePruned && !fPruneMode)
+                // in the past, but is now trying to run unpruned.  A node started from a UTXO snapshot never had
+                // the blocks below it, which looks the same.
+                bool fFromSnapshot = false;
+                pblocktree->ReadFlag("utxosnapshot", fFromSnapshot);
+                if (fHavePruned && !fPruneMode && !fFromSnapshot)
                 {
                     strLoadError = _("You need to rebuild the database using -reindex to go back to unpruned mode.  "
                                      "This will redownload the entire blockchain");
@@ -1218,6 +1251,13 @@ bool AppInit2(Config &config, thread_group &threadGroup)
                     strLoadError = _("Corrupted block database detected");
                     break;
                 }
+
+                uiInterface.InitMessage(_("Loading UTXO set statistics..."));
+                if (!LoadUTXOStats(pcoinsdbview))
+                {
+                    strLoadError = _("Error computing the UTXO set statistics");
+                    break;
+                }
             }
             catch (const std::exception &e)
             {
@@ -10,6 +10,7 @@
 #endif
 
 #include <limits>
+#include <mutex>
 
 // Variables for traffic shaping
 extern const int64_t DEFAULT_MAX_RECV_BURST;
@@ -32,9 +33,11 @@ protected:
     int64_t fill; // Average rate per second
     static CClock clock;
     std::chrono::time_point<CClock> lastFill;
+    // Buckets are shared by all the socket handler threads.  The lock is not taken when shaping is off.
+    std::mutex cs_bucket;
 
     // This function is called internally to fill the leaky bucket based on the time difference between now and the last
-    // time the function was called.
+    // time the function was called.  Requires cs_bucket.
     void fillIt()
     {
         std::chrono::time_point<CClock> now = clock.now();
@@ -64,6 +67,7 @@ public:
     // use "set" to restart
     void disable(void)
     {
+        std::lock_guard<std::mutex> lock(cs_bucket);
         fill = std::numeric_limits<long long>::max();
         max = std::numeric_limits<long long>::max();
     }
@@ -71,6 +75,7 @@ public:
     // Access the values in this bucket
     void get(int64_t *maxp, int64_t *fillp, int64_t *levelp = nullptr)
     {
+        std::lock_guard<std::mutex> lock(cs_bucket);
         if (maxp)
             *maxp = max;
         if (fillp)
@@ -82,6 +87,7 @@ public:
     // Change the settings of the leaky bucket
     void set(int64_t maxp, int64_t fillp)
     {
+        std::lock_guard<std::mutex> lock(cs_bucket);
         max = maxp;
         fill = fillp;
         if (level > max)
@@ -94,6 +100,7 @@ public:
     {
         if (fill == std::numeric_limits<long long>::max())
             return std::numeric_limits<long long>::max(); // shaping is off
+        std::lock_guard<std::mutex> lock(cs_bucket);
         fillIt();
         return (level > cutoff) ? level : 0;
     }
@@ -104,6 +111,7 @@ public:
         if (fill == std::numeric_limits<long long>::max())
             return true; // leaky bucket is turned off.
         assert(amt >= 0);
+        std::lock_guard<std::mutex> lock(cs_bucket);
         fillIt();
         if (level >= amt)
         {
@@ -120,6 +128,7 @@ public:
     {
         if (fill == std::numeric_limits<long long>::max())
             return true; // leaky bucket is turned off.
+        std::lock_guard<std::mutex> lock(cs_bucket);
         fillIt();
         level -= amt;
         return (level >= 0);
@@ -25,8 +25,10 @@
 #include "dosman.h"
 #include "hashwrapper.h"
 #include "iblt.h"
+#include "netbufferpool.h"
 #include "primitives/transaction.h"
 #include "requestManager.h"
+#include "socketevents.h"
 #include "ui_interface.h"
 #include "unlimited.h"
 #include "utilstrencodings.h"
@@ -47,6 +49,7 @@ extern CTweak<bool> ignoreNetTimeouts;
 #include <miniupnpc/upnperrors.h>
 #endif
 
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <chrono>
 #include <thread>
@@ -109,6 +112,81 @@ static bool vfLimited[NET_MAX] = {};
 static CNode *pnodeLocalHost = nullptr;
 uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
+
+/** One socket handler thread and the peers pinned to it.  Only the first shard accepts connections and cleans up
+    disconnected nodes, all shards service the sockets of their own peers. */
+class CSocketHandlerShard
+{
+public:
+    const unsigned int nId;
+
+    CCriticalSection cs_shardNodes;
+    //! The peers serviced by this thread.  Each holds a reference which is released by this thread once the peer's
+    //! socket has been closed, so that a node can not be deleted while this thread may still see events for it.
+    std::vector<CNode *> vShardNodes GUARDED_BY(cs_shardNodes);
+
+    std::atomic<uint64_t> nBytesRecv{0};
+    std::atomic<uint64_t> nBytesSent{0};
+    std::atomic<uint64_t> nLoops{0};
+
+#ifdef USE_EPOLL
+    //! This thread's epoll instance, or nullptr if the select backend is in use
+    CEpollSocketEvents *pEvents = nullptr;
+#endif
+
+    //! Messages are first pulled into this buffer
+    char recvMsgBuf[MAX_RECV_CHUNK];
+
+    CSocketHandlerShard(unsigned int id) : nId(id) {}
+    ~CSocketHandlerShard()
+    {
+#ifdef USE_EPOLL
+        // releases the references held on nodes waiting to be woken up
+        delete pEvents;
+#endif
+        LOCK(cs_shardNodes);
+        for (CNode *pnode : vShardNodes)
+            pnode->Release();
+        vShardNodes.clear();
+    }
+
+    size_t NumPeers()
+    {
+        LOCK(cs_shardNodes);
+        return vShardNodes.size();
+    }
+
+    /** Drop the references held on peers whose sockets have been closed.  Must be called by this shard's thread,
+        between waits for socket events. */
+    void ReleaseClosedNodes()
+    {
+        LOCK(cs_shardNodes);
+        for (size_t i = 0; i < vShardNodes.size();)
+        {
+            CNode *pnode = vShardNodes[i];
+            if (pnode->hSocket != INVALID_SOCKET)
+            {
+                i++;
+                continue;
+            }
+            pnode->Release();
+            vShardNodes[i] = vShardNodes.back();
+            vShardNodes.pop_back();
+        }
+    }
+};
+// Created by StartNode, so this is only modified while no socket handler or message handler threads are running
+static std::vector<CSocketHandlerShard *> vSocketShards;
+#ifdef USE_EPOLL
+/** Return the epoll instance of the socket handler pnode is pinned to, or nullptr if there is none */
+static CEpollSocketEvents *GetSocketEvents(const CNode *pnode)
+{
+    int nShard = pnode->nSocketShard;
+    if (nShard < 0 || (size_t)nShard >= vSocketShards.size())
+        return nullptr;
+    return vSocketShards[nShard]->pEvents;
+}
+#endif
 extern CAddrMan addrman;
 int nMaxConnections = DEFAULT_MAX_PEER_CONNECTIONS;
 int nMinXthinNodes = MIN_XTHIN_NODES;
@@ -442,6 +520,37 @@ int DisconnectSubNetNodes(const CSubNet &subNet)
     return nDisconnected;
 }
 
+/** Pin a newly connected node to the socket handler thread with the fewest peers.  Returns false if the node's
+    socket could not be registered with that thread. */
+static bool AssignSocketShard(CNode *pnode)
+{
+    if (vSocketShards.empty())
+        return true;
+
+    CSocketHandlerShard *shard = vSocketShards[0];
+    size_t nFewest = shard->NumPeers();
+    for (size_t i = 1; i < vSocketShards.size(); i++)
+    {
+        size_t nPeers = vSocketShards[i]->NumPeers();
+        if (nPeers < nFewest)
+        {
+            nFewest = nPeers;
+            shard = vSocketShards[i];
+        }
+    }
+
+    {
+        LOCK(shard->cs_shardNodes);
+        shard->vShardNodes.push_back(pnode->AddRef());
+        pnode->nSocketShard = shard->nId;
+    }
+#ifdef USE_EPOLL
+    if (shard->pEvents)
+        return shard->pEvents->AddNode(pnode);
+#endif
+    return true;
+}
+
 CNode *ConnectNode(CAddress addrConnect, const char *pszDest, bool fCountFailure)
 {
     if (pszDest == nullptr)
@@ -473,7 +582,7 @@ CNode *ConnectNode(CAddress addrConnect, const char *pszDest, bool fCountFailure
                       &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket))
+        if (!IsServiceableSocket(hSocket))
         {
             LOG(NET, "Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
@@ -490,6 +599,8 @@ CNode *ConnectNode(CAddress addrConnect, const char *pszDest, bool fCountFailure
             LOCK(cs_vNodes);
             vNodes.push_back(pnode);
         }
+        if (!AssignSocketShard(pnode))
+            pnode->fDisconnect = true;
 
         pnode->nTimeConnected = GetTime();
 
@@ -515,6 +626,11 @@ void CNode::CloseSocketDisconnect()
     if (hSocket != INVALID_SOCKET)
     {
         LOG(NET, "disconnecting peer %s\n", GetLogName());
+#ifdef USE_EPOLL
+        CEpollSocketEvents *pEvents = GetSocketEvents(this);
+        if (pEvents)
+            pEvents->RemoveSocket(hSocket);
+#endif
         CloseSocket(hSocket);
     }
 
@@ -682,6 +798,13 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
     return true;
 }
 
+CNetMessage::~CNetMessage()
+{
+    CSerializeData buf;
+    vRecv.swap(buf);
+    netBufferPool.Put(buf);
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -724,7 +847,14 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
     if (vRecv.size() < nDataPos + nCopy)
     {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        unsigned int nAhead = std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024);
+        if (nDataPos == 0)
+        {
+            CSerializeData buf;
+            netBufferPool.Get(buf, nAhead);
+            vRecv.swap(buf);
+        }
+        vRecv.resize(nAhead);
     }
 
     memcpy(&vRecv[nDataPos], pch, nCopy);
@@ -735,7 +865,7 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
 
 // requires LOCK(cs_vSend), BU: returns > 0 if any data was sent, 0 if nothing accomplished.
-int SocketSendData(CNode *pnode)
+int SocketSendData(CNode *pnode, bool *pfWouldBlock)
 {
     // BU This variable is incremented if something happens.  If it is zero at the bottom of the loop, we delay.  This
     // solves spin loop issues where the select does not block but no bytes can be transferred (traffic shaping limited,
@@ -802,6 +932,10 @@ int SocketSendData(CNode *pnode)
                     LOG(NET, "socket send error '%s' to %s\n", NetworkErrorString(nErr), pnode->GetLogName());
                     pnode->fDisconnect = true;
                 }
+                else if (nErr == WSAEWOULDBLOCK && pfWouldBlock)
+                {
+                    *pfWouldBlock = true;
+                }
             }
             // couldn't send anything at all
             break;
@@ -816,6 +950,8 @@ int SocketSendData(CNode *pnode)
         // assert(pnode->nSendOffset == 0);
         // assert(pnode->nSendSize == 0);
     }
+    for (std::deque<CSerializeData>::iterator sent = pnode->vSendMsg.begin(); sent != it; ++sent)
+        netBufferPool.Put(*sent);
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return progress;
 }
@@ -988,7 +1124,7 @@ static void AcceptConnection(const ListenSocket &hListenSocket)
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!IsServiceableSocket(hSocket))
     {
         LOG(NET, "connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1113,10 +1249,10 @@ static void AcceptConnection(const ListenSocket &hListenSocket)
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    if (!AssignSocketShard(pnode))
+        pnode->fDisconnect = true;
 }
 
-char recvMsgBuf[MAX_RECV_CHUNK]; // Messages are first pulled into this buffer
-
 void CleanupDisconnectedNodes()
 {
     //
@@ -1184,8 +1320,125 @@ void CleanupDisconnectedNodes()
     }
 }
 
-void ThreadSocketHandler()
+/**
+ * Pull one chunk of data off of pnode's socket into its receive queue.  Returns false if the connection was closed
+ * or failed.  If pfWouldBlock is given it is set to true when the socket has no more data to read.
+ * Requires cs_vRecvMsg.
+ */
+static bool SocketRecvData(CSocketHandlerShard *shard, CNode *pnode, int &progress, bool *pfWouldBlock = nullptr)
+{
+    AssertLockHeld(pnode->cs_vRecvMsg);
+    int64_t amt2Recv = receiveShaper.available(RECV_SHAPER_MIN_FRAG);
+    if (amt2Recv <= 0)
+        return true;
+
+    progress++;
+    SOCKET hSocket = pnode->hSocket; // get it again inside the lock
+    if (hSocket == INVALID_SOCKET)
+        return false;
+    // max of min makes sure amt is in a range reasonable for buffer allocation
+    int64_t amt = max((int64_t)1, min(amt2Recv, MAX_RECV_CHUNK));
+    int nBytes = recv(hSocket, shard->recvMsgBuf, amt, MSG_DONTWAIT);
+    if (nBytes > 0)
+    {
+        receiveShaper.leak(nBytes);
+        shard->nBytesRecv += nBytes;
+        if (!pnode->ReceiveMsgBytes(shard->recvMsgBuf, nBytes))
+            pnode->fDisconnect = true;
+        int64_t tmp = GetTime();
+        pnode->recvGap << (tmp - pnode->nLastRecv);
+        pnode->nLastRecv = tmp;
+        pnode->nRecvBytes += nBytes;
+        pnode->bytesReceived += nBytes; // BU stats
+        pnode->RecordBytesRecv(nBytes);
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LOG(NET, "Node %s socket closed\n", pnode->GetLogName());
+        pnode->fDisconnect = true;
+        return false;
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LOG(NET, "Node %s socket recv error '%s'\n", pnode->GetLogName(), NetworkErrorString(nErr));
+            pnode->fDisconnect = true;
+            return false;
+        }
+        if (nErr == WSAEWOULDBLOCK && pfWouldBlock)
+            *pfWouldBlock = true;
+    }
+    return true;
+}
+
+/** Send as much of pnode's queued data as possible, accounting the bytes to shard.  Requires cs_vSend. */
+static int SocketSendData(CSocketHandlerShard *shard, CNode *pnode, bool *pfWouldBlock = nullptr)
+{
+    AssertLockHeld(pnode->cs_vSend);
+    uint64_t nSendBytesBefore = pnode->nSendBytes;
+    int progress = SocketSendData(pnode, pfWouldBlock);
+    shard->nBytesSent += pnode->nSendBytes - nSendBytesBefore;
+    return progress;
+}
+
+/** Do the work that only one of the socket handler threads should do: clean up disconnected nodes */
+static void SocketHandlerHousekeeping(unsigned int &nPrevNodeCount)
+{
+    stat_io_service.poll(); // BU instrumentation
+    CleanupDisconnectedNodes();
+    if (vNodes.size() != nPrevNodeCount)
+    {
+        nPrevNodeCount = vNodes.size();
+        uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
+    }
+}
+
+/** Disconnect pnode if it has not sent, received or answered a ping for too long */
+static void CheckNodeInactivity(CNode *pnode)
 {
+    int64_t stopwatchTime = GetStopwatchMicros();
+    if (stopwatchTime - pnode->nStopwatchConnected > 60 * 1000000)
+    {
+        int64_t nTime = GetTime();
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LOG(NET, "Node %s socket no message in first 60 seconds, %d %d from %d\n", pnode->GetLogName(),
+                pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            if (ignoreNetTimeouts.Value() == false)
+                pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LOG(NET, "Node %s socket sending timeout: %is\n", pnode->GetLogName(), nTime - pnode->nLastSend);
+            if (ignoreNetTimeouts.Value() == false)
+                pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > TIMEOUT_INTERVAL)
+        {
+            LOG(NET, "Node %s socket receive timeout: %is\n", pnode->GetLogName(), nTime - pnode->nLastRecv);
+            if (ignoreNetTimeouts.Value() == false)
+                pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent &&
+                 pnode->nPingUsecStart + (TIMEOUT_INTERVAL * 1000000) < (int64_t)GetStopwatchMicros())
+        {
+            LOG(NET, "Node %s ping timeout: %fs\n", pnode->GetLogName(),
+                0.000001 * (GetStopwatchMicros() - pnode->nPingUsecStart));
+            if (ignoreNetTimeouts.Value() == false)
+                pnode->fDisconnect = true;
+        }
+    }
+}
+
+static void ThreadSocketHandlerSelect(CSocketHandlerShard *shard)
+{
+    const bool fPrimary = (shard->nId == 0);
     unsigned int nPrevNodeCount = 0;
     // This variable is incremented if something happens.  If it is zero at the bottom of the loop, we delay.  This
     // solves spin loop issues where the select does not block but no bytes can be transferred (traffic shaping limited,
@@ -1196,12 +1449,17 @@ void ThreadSocketHandler()
     {
         progress = 0;
         fAquiredAllRecvLocks = true;
-        stat_io_service.poll(); // BU instrumentation
-        CleanupDisconnectedNodes();
-        if (vNodes.size() != nPrevNodeCount)
+        shard->nLoops++;
+        if (fPrimary)
+            SocketHandlerHousekeeping(nPrevNodeCount);
+        shard->ReleaseClosedNodes();
+
+        // Only this thread releases the references held by the shard, so these nodes can not be deleted until the
+        // next loop.
+        vector<CNode *> vNodesCopy;
         {
-            nPrevNodeCount = vNodes.size();
-            uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
+            LOCK(shard->cs_shardNodes);
+            vNodesCopy = shard->vShardNodes;
         }
 
         //
@@ -1221,60 +1479,60 @@ void ThreadSocketHandler()
         bool have_fds = false;
         std::set<SOCKET> setSocket;
 
-        for (const ListenSocket &hListenSocket : vhListenSocket)
+        if (fPrimary)
         {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-            setSocket.insert(hListenSocket.socket);
+            for (const ListenSocket &hListenSocket : vhListenSocket)
+            {
+                FD_SET(hListenSocket.socket, &fdsetRecv);
+                hSocketMax = max(hSocketMax, hListenSocket.socket);
+                have_fds = true;
+                setSocket.insert(hListenSocket.socket);
+            }
         }
 
+        for (CNode *pnode : vNodesCopy)
         {
-            LOCK(cs_vNodes);
-            for (CNode *pnode : vNodes)
+            // It is necessary to use a temporary variable to ensure that pnode->hSocket is not changed by another
+            // thread during execution.
+            // If the socket is closed and even reopened for some unrelated connection, the worst case is that we
+            // get a spurious wakeup, so a mutex is not needed to protect the entire use of the socket.
+            SOCKET hSocket = pnode->hSocket;
+            if (hSocket == INVALID_SOCKET)
+                continue;
+            FD_SET(hSocket, &fdsetError);
+            hSocketMax = max(hSocketMax, hSocket);
+            have_fds = true;
+            setSocket.insert(hSocket);
+
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is no (complete) message in the receive buffer,
+            //   or there is space left in the buffer, select() for receiving data.
+            // * (if neither of the above applies, there is certainly one message
+            //   in the receiver buffer ready to be processed).
+            // Together, that means that at least one of the following is always possible,
+            // so we don't deadlock:
+            // * We send some data.
+            // * We wait for data to be received (and disconnect after timeout).
+            // * We process a message in the buffer (message handler thread).
             {
-                // It is necessary to use a temporary variable to ensure that pnode->hSocket is not changed by another
-                // thread during execution.
-                // If the socket is closed and even reopened for some unrelated connection, the worst case is that we
-                // get a spurious wakeup, so a mutex is not needed to protect the entire use of the socket.
-                SOCKET hSocket = pnode->hSocket;
-                if (hSocket == INVALID_SOCKET)
-                    continue;
-                FD_SET(hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, hSocket);
-                have_fds = true;
-                setSocket.insert(hSocket);
-
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
-                {
-                    TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty())
-                    {
-                        FD_SET(hSocket, &fdsetSend);
-                        continue;
-                    }
-                }
+                TRY_LOCK(pnode->cs_vSend, lockSend);
+                if (lockSend && !pnode->vSendMsg.empty())
                 {
-                    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(hSocket, &fdsetRecv);
+                    FD_SET(hSocket, &fdsetSend);
+                    continue;
                 }
             }
+            {
+                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                if (lockRecv && (pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+                                    pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
+                    FD_SET(hSocket, &fdsetRecv);
+            }
         }
 
         int nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
@@ -1303,7 +1561,7 @@ void ThreadSocketHandler()
         //
         for (const ListenSocket &hListenSocket : vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (fPrimary && hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1312,19 +1570,11 @@ void ThreadSocketHandler()
         //
         // Service each socket
         //
-        vector<CNode *> vNodesCopy;
-        {
-            LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode *pnode : vNodesCopy)
-                pnode->AddRef();
-        }
-
         for (CNode *pnode : vNodesCopy)
         {
             if (shutdown_threads.load() == true)
             {
-                break; // drop out of this loop so we can quickly release node refs and return
+                return;
             }
 
             //
@@ -1337,56 +1587,13 @@ void ThreadSocketHandler()
             if (FD_ISSET(hSocket, &fdsetRecv) || FD_ISSET(hSocket, &fdsetError))
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                int64_t amt2Recv = receiveShaper.available(RECV_SHAPER_MIN_FRAG);
                 if (!lockRecv)
                 {
                     fAquiredAllRecvLocks = false;
                 }
-                else if (amt2Recv > 0)
+                else if (!SocketRecvData(shard, pnode, progress))
                 {
-                    {
-                        progress++;
-                        hSocket = pnode->hSocket; // get it again inside the lock
-                        if (hSocket == INVALID_SOCKET)
-                            continue;
-                        // max of min makes sure amt is in a range reasonable for buffer allocation
-                        int64_t amt = max((int64_t)1, min(amt2Recv, MAX_RECV_CHUNK));
-                        int nBytes = recv(hSocket, recvMsgBuf, amt, MSG_DONTWAIT);
-                        if (nBytes > 0)
-                        {
-                            receiveShaper.leak(nBytes);
-                            if (!pnode->ReceiveMsgBytes(recvMsgBuf, nBytes))
-                                pnode->fDisconnect = true;
-                            int64_t tmp = GetTime();
-                            pnode->recvGap << (tmp - pnode->nLastRecv);
-                            pnode->nLastRecv = tmp;
-                            pnode->nRecvBytes += nBytes;
-                            pnode->bytesReceived += nBytes; // BU stats
-                            pnode->RecordBytesRecv(nBytes);
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LOG(NET, "Node %s socket closed\n", pnode->GetLogName());
-                            pnode->fDisconnect = true;
-                            continue;
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR &&
-                                nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    LOG(NET, "Node %s socket recv error '%s'\n", pnode->GetLogName(),
-                                        NetworkErrorString(nErr));
-                                pnode->fDisconnect = true;
-                                continue;
-                            }
-                        }
-                    }
+                    continue;
                 }
             }
 
@@ -1401,58 +1608,201 @@ void ThreadSocketHandler()
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend && sendShaper.try_leak(0))
                 {
-                    progress += SocketSendData(pnode);
+                    progress += SocketSendData(shard, pnode);
                 }
             }
 
             //
             // Inactivity checking
             //
-            int64_t stopwatchTime = GetStopwatchMicros();
-            if (stopwatchTime - pnode->nStopwatchConnected > 60 * 1000000)
+            CheckNodeInactivity(pnode);
+        }
+
+        // BU: Nothing happened even though select did not block.  So slow us down.
+        if (progress == 0 && fAquiredAllRecvLocks)
+            MilliSleep(5);
+    }
+}
+
+#ifdef USE_EPOLL
+/**
+ * Do whatever socket work pnode's remembered readiness allows.  Returns true if the node still has work that can
+ * proceed without another readiness notification, false if it can wait for the next epoll event.
+ */
+static bool ServiceNodeSocket(CSocketHandlerShard *shard, CNode *pnode, int &progress, bool &fAquiredAllRecvLocks)
+{
+    if (pnode->hSocket == INVALID_SOCKET)
+        return false;
+
+    // Like the select loop, drain the write buffer before receiving more so TCP flow control works, and leave data
+    // in the kernel while a complete message is waiting to be processed and the receive buffer is full.
+    if (pnode->fSocketRecvReady && pnode->nSendSize == 0)
+    {
+        TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+        if (!lockRecv)
+        {
+            fAquiredAllRecvLocks = false;
+        }
+        else if (pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+                 pnode->GetTotalRecvSize() <= ReceiveFloodSize())
+        {
+            bool fWouldBlock = false;
+            if (!SocketRecvData(shard, pnode, progress, &fWouldBlock))
+                return false;
+            if (fWouldBlock)
+                pnode->fSocketRecvReady = false;
+        }
+    }
+
+    if (pnode->fSocketSendReady && pnode->nSendSize > 0)
+    {
+        TRY_LOCK(pnode->cs_vSend, lockSend);
+        if (lockSend && sendShaper.try_leak(0))
+        {
+            bool fWouldBlock = false;
+            progress += SocketSendData(shard, pnode, &fWouldBlock);
+            if (fWouldBlock)
+                pnode->fSocketSendReady = false;
+        }
+    }
+
+    if (pnode->nSendSize > 0)
+        return pnode->fSocketSendReady;
+    return pnode->fSocketRecvReady;
+}
+
+static void ThreadSocketHandlerEpoll(CSocketHandlerShard *shard)
+{
+    const bool fPrimary = (shard->nId == 0);
+    CEpollSocketEvents *pEvents = shard->pEvents;
+    unsigned int nPrevNodeCount = 0;
+    int progress;
+    bool fAquiredAllRecvLocks;
+    // Nodes with socket work that can proceed without waiting for another readiness event.  Each holds a reference.
+    std::vector<CNode *> vActive;
+    std::vector<CEpollSocketEvents::Event> vEvents;
+    std::vector<CNode *> vWoken;
+    int64_t nLastInactivityCheck = 0;
+
+    while (true)
+    {
+        progress = 0;
+        fAquiredAllRecvLocks = true;
+        shard->nLoops++;
+        if (fPrimary)
+            SocketHandlerHousekeeping(nPrevNodeCount);
+        // Closed sockets have been removed from the epoll set so no more events can be returned for these nodes
+        shard->ReleaseClosedNodes();
+
+        // Only block if there is no outstanding work left over from the last loop
+        if (!pEvents->Wait(vEvents, vActive.empty() ? 50 : 0))
+            MilliSleep(50);
+        if (shutdown_threads.load() == true)
+            break;
+
+        for (const CEpollSocketEvents::Event &ev : vEvents)
+        {
+            if (ev.pnode == nullptr)
             {
-                int64_t nTime = GetTime();
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LOG(NET, "Node %s socket no message in first 60 seconds, %d %d from %d\n", pnode->GetLogName(),
-                        pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    if (ignoreNetTimeouts.Value() == false)
-                        pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LOG(NET, "Node %s socket sending timeout: %is\n", pnode->GetLogName(), nTime - pnode->nLastSend);
-                    if (ignoreNetTimeouts.Value() == false)
-                        pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > TIMEOUT_INTERVAL)
-                {
-                    LOG(NET, "Node %s socket receive timeout: %is\n", pnode->GetLogName(), nTime - pnode->nLastRecv);
-                    if (ignoreNetTimeouts.Value() == false)
-                        pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent &&
-                         pnode->nPingUsecStart + (TIMEOUT_INTERVAL * 1000000) < (int64_t)GetStopwatchMicros())
-                {
-                    LOG(NET, "Node %s ping timeout: %fs\n", pnode->GetLogName(),
-                        0.000001 * (GetStopwatchMicros() - pnode->nPingUsecStart));
-                    if (ignoreNetTimeouts.Value() == false)
-                        pnode->fDisconnect = true;
-                }
+                const ListenSocket &hListenSocket = vhListenSocket[ev.nListenIdx];
+                if (hListenSocket.socket != INVALID_SOCKET)
+                    AcceptConnection(hListenSocket);
+                continue;
+            }
+
+            CNode *pnode = ev.pnode;
+            if (ev.fRecv || ev.fError)
+                pnode->fSocketRecvReady = true;
+            if (ev.fSend)
+                pnode->fSocketSendReady = true;
+            if (!pnode->fSocketActive)
+            {
+                pnode->fSocketActive = true;
+                vActive.push_back(pnode->AddRef());
             }
         }
-        // A cs_vNodes lock is not required here when releasing refs for two reasons: one, this only decrements
-        // an atomic counter, and two, the counter will always be > 0 at this point, so we don't have to worry
-        // that a pnode could be disconnected and no longer exist before the decrement takes place.
-        for (CNode *pnode : vNodesCopy)
+
+        // Nodes whose optimistic write could not send everything
+        vWoken.clear();
+        pEvents->TakeWakeups(vWoken);
+        for (CNode *pnode : vWoken)
         {
+            if (pnode->fSocketActive)
+            {
+                pnode->Release();
+                continue;
+            }
+            pnode->fSocketActive = true;
+            vActive.push_back(pnode);
+        }
+
+        for (size_t i = 0; i < vActive.size();)
+        {
+            CNode *pnode = vActive[i];
+            if (ServiceNodeSocket(shard, pnode, progress, fAquiredAllRecvLocks))
+            {
+                i++;
+                continue;
+            }
+            pnode->fSocketActive = false;
             pnode->Release();
+            vActive[i] = vActive.back();
+            vActive.pop_back();
         }
 
-        // BU: Nothing happened even though select did not block.  So slow us down.
-        if (progress == 0 && fAquiredAllRecvLocks)
+        // Timeouts do not generate socket events so look at every node once a second
+        int64_t nNow = GetTime();
+        if (nNow != nLastInactivityCheck)
+        {
+            nLastInactivityCheck = nNow;
+            LOCK(shard->cs_shardNodes);
+            for (CNode *pnode : shard->vShardNodes)
+            {
+                if (pnode->hSocket != INVALID_SOCKET)
+                    CheckNodeInactivity(pnode);
+            }
+        }
+
+        // BU: There is outstanding work but nothing could be done (traffic shaping or receive flood limits, for
+        // example) so slow us down.
+        if (!vActive.empty() && progress == 0 && fAquiredAllRecvLocks)
             MilliSleep(5);
     }
+
+    for (CNode *pnode : vActive)
+    {
+        pnode->fSocketActive = false;
+        pnode->Release();
+    }
+}
+#endif
+
+static void ThreadSocketHandler(CSocketHandlerShard *shard)
+{
+#ifdef USE_EPOLL
+    if (shard->pEvents)
+    {
+        ThreadSocketHandlerEpoll(shard);
+        return;
+    }
+#endif
+    ThreadSocketHandlerSelect(shard);
+}
+
+std::vector<CSocketHandlerStats> GetSocketHandlerStats()
+{
+    std::vector<CSocketHandlerStats> vStats;
+    for (CSocketHandlerShard *shard : vSocketShards)
+    {
+        CSocketHandlerStats stats;
+        stats.nThread = shard->nId;
+        stats.nPeers = shard->NumPeers();
+        stats.nBytesRecv = shard->nBytesRecv;
+        stats.nBytesSent = shard->nBytesSent;
+        stats.nLoops = shard->nLoops;
+        vStats.push_back(stats);
+    }
+    return vStats;
 }
 
 #ifdef USE_UPNP
@@ -2265,7 +2615,7 @@ static bool threadProcessMessages(CNode *pnode)
     return fSleep;
 }
 
-void ThreadMessageHandler()
+void ThreadMessageHandler(unsigned int nThreadIdx, unsigned int nThreads)
 {
     boost::mutex condition_mutex;
     boost::unique_lock<boost::mutex> lock(condition_mutex);
@@ -2307,42 +2657,28 @@ void ThreadMessageHandler()
                 requester.RequestMempoolSync(syncPeer);
         }
 
-        for (CNode *pnode : vNodesCopy)
+        // Each thread starts at a different node so that the threads spread out over the peers instead of queueing
+        // up behind each other, and a peer that takes a long time to process only holds up the thread working on it.
+        const size_t nNodes = vNodesCopy.size();
+        const size_t nStart = (nNodes * nThreadIdx) / nThreads;
+        for (size_t i = 0; i < nNodes; i++)
         {
+            CNode *pnode = vNodesCopy[(nStart + i) % nNodes];
             if (pnode->fDisconnect)
                 continue;
 
-            if (pnode->successfullyConnected())
-            {
-                // parallel processing
-                fSleep &= threadProcessMessages(pnode);
-            }
-            else
-            {
-                // serial processing during setup
-                TRY_LOCK(pnode->csSerialPhase, lockSerial);
-                if (lockSerial)
-                    fSleep &= threadProcessMessages(pnode);
-            }
-            if (shutdown_threads.load() == true)
-            {
-                break; // skip down to where we release the node refs
-            }
+            // If another thread is already working on this node then its messages are being taken care of
+            if (pnode->fProcessingMessages.exchange(true))
+                continue;
+
+            fSleep &= threadProcessMessages(pnode);
 
             // Put transaction and block requests into the request manager
             // and all other requests into the send queue.
-            if (pnode->successfullyConnected())
-            {
-                // parallel processing
+            if (shutdown_threads.load() == false)
                 g_signals.SendMessages(pnode);
-            }
-            else
-            {
-                // serial processing during setup
-                TRY_LOCK(pnode->csSerialPhase, lockSerial);
-                if (lockSerial)
-                    g_signals.SendMessages(pnode);
-            }
+
+            pnode->fProcessingMessages = false;
             if (shutdown_threads.load() == true)
             {
                 break; // skip down to where we release the node refs
@@ -2394,7 +2730,7 @@ bool BindListenPort(const CService &addrBind, string &strError, bool fWhiteliste
         LOGA("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket))
+    if (!IsServiceableSocket(hListenSocket))
     {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LOGA("%s\n", strError);
@@ -2587,8 +2923,43 @@ void StartNode(thread_group &threadGroup)
     // Map ports with UPnP
     MapPort(GetBoolArg("-upnp", DEFAULT_UPNP));
 
+    unsigned int nSocketThreads = std::max(numSocketHandlerThreads.Value(), (unsigned int)1);
+    if (vSocketShards.empty())
+    {
+        for (unsigned int i = 0; i < nSocketThreads; i++)
+            vSocketShards.push_back(new CSocketHandlerShard(i));
+    }
+#ifdef USE_EPOLL
+    if (socketBackend == SocketBackend::EPOLL && vSocketShards[0]->pEvents == nullptr)
+    {
+        bool fOk = true;
+        for (CSocketHandlerShard *shard : vSocketShards)
+        {
+            shard->pEvents = new CEpollSocketEvents();
+            fOk = fOk && shard->pEvents->Init();
+        }
+        // Only the first socket handler accepts connections
+        for (size_t i = 0; fOk && i < vhListenSocket.size(); i++)
+            fOk = vSocketShards[0]->pEvents->AddListenSocket(vhListenSocket[i].socket, i);
+        if (!fOk)
+        {
+            LOGA("Unable to initialize epoll, falling back to select for network sockets\n");
+            for (CSocketHandlerShard *shard : vSocketShards)
+            {
+                delete shard->pEvents;
+                shard->pEvents = nullptr;
+            }
+            socketBackend = SocketBackend::SELECT;
+        }
+    }
+#endif
+    LOGA("Using %s for network sockets in %u threads\n", SocketBackendName(socketBackend), vSocketShards.size());
+
     // Send and receive from sockets, accept connections
-    threadGroup.create_thread(&ThreadSocketHandler);
+    for (CSocketHandlerShard *shard : vSocketShards)
+    {
+        threadGroup.create_thread(boost::bind(&ThreadSocketHandler, shard));
+    }
 
     // Initiate outbound connections from -addnode
     threadGroup.create_thread(&ThreadOpenAddedConnections);
@@ -2597,9 +2968,10 @@ void StartNode(thread_group &threadGroup)
     threadGroup.create_thread(&ThreadOpenConnections);
 
     // Process messages
-    for (unsigned int i = 0; i < numMsgHandlerThreads.Value(); i++)
+    unsigned int nMsgThreads = std::max(numMsgHandlerThreads.Value(), (unsigned int)1);
+    for (unsigned int i = 0; i < nMsgThreads; i++)
     {
-        threadGroup.create_thread(&ThreadMessageHandler);
+        threadGroup.create_thread(boost::bind(&ThreadMessageHandler, i, nMsgThreads));
     }
 
     // Dump network addresses
@@ -2625,6 +2997,11 @@ bool StopNode()
 
 void NetCleanup()
 {
+    // releases the references the socket handlers hold on nodes so that they can be deleted below
+    for (CSocketHandlerShard *shard : vSocketShards)
+        delete shard;
+    vSocketShards.clear();
+
     // clean up some globals (to help leak detection)
     {
         LOCK(cs_vNodes);
@@ -3147,7 +3524,7 @@ void CNode::AbortMessage() UNLOCK_FUNCTION(cs_vSend)
     LOG(NET, "(aborted)\n");
 }
 
-void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
+void CNode::EndMessage(const uint32_t *pnChecksum) UNLOCK_FUNCTION(cs_vSend)
 {
     // The -*messagestest options are intentionally not documented in the help message,
     // since they are only used during development to debug the networking code and are
@@ -3159,7 +3536,10 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
         return;
     }
     if (mapArgs.count("-fuzzmessagestest"))
+    {
         Fuzz(GetArg("-fuzzmessagestest", 10));
+        pnChecksum = nullptr;
+    }
 
     if (ssSend.size() == 0)
     {
@@ -3174,7 +3554,9 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
 
     // Set the checksum
     uint32_t nChecksum = 0; // If we can skip the checksum, we send 0 instead
-    if (!skipChecksum)
+    if (!skipChecksum && pnChecksum)
+        nChecksum = *pnChecksum;
+    else if (!skipChecksum)
     {
         uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
         memcpy(&nChecksum, &hash, sizeof(nChecksum));
@@ -3214,16 +3596,46 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
         it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
     // BU: end
 
-    ssSend.GetAndClear(*it);
+    if (ssSend.size() >= MIN_SEND_SWAP_SIZE)
+    {
+        // Move big messages into the queue rather than copying them.  This also keeps ssSend from holding on to a
+        // block sized buffer between messages.
+        ssSend.swap(*it);
+    }
+    else
+    {
+        netBufferPool.Get(*it, ssSend.size());
+        ssSend.GetAndClear(*it);
+    }
     nSendSize.fetch_add((*it).size());
 
     // If write queue empty, attempt "optimistic write"
     if (it == vSendMsg.begin())
+    {
         SocketSendData(this);
+#ifdef USE_EPOLL
+        // The epoll socket handler only looks at nodes it was told about, so if the optimistic write did not send
+        // everything let it know there is data waiting.
+        CEpollSocketEvents *pEvents = GetSocketEvents(this);
+        if (pEvents && !vSendMsg.empty())
+            pEvents->Wakeup(this);
+#endif
+    }
 
     LEAVE_CRITICAL_SECTION(cs_vSend);
 }
 
+void CNode::PushRawMessage(const char *pszCommand, CSerializeData &payload, const uint32_t *pnChecksum)
+{
+    assert(payload.size() >= CMessageHeader::HEADER_SIZE);
+    BeginMessage(pszCommand);
+    // Put the header in front of the payload and make that the message.  EndMessage fills in the size and checksum.
+    memcpy(&payload[0], &ssSend[0], CMessageHeader::HEADER_SIZE);
+    ssSend.swap(payload);
+    EndMessage(pnChecksum);
+    netBufferPool.Put(payload);
+}
+
 /**
  * Check if it is flagged for banning, and if so ban it and disconnect.
  */
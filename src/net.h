@@ -54,6 +54,7 @@ class thread_group;
 } // namespace boost
 
 extern CTweak<unsigned int> numMsgHandlerThreads;
+extern CTweak<unsigned int> numSocketHandlerThreads;
 
 /** Time between pings automatically sent out for latency probing and keepalive (in seconds). */
 static const int PING_INTERVAL = 2 * 60;
@@ -125,7 +126,23 @@ unsigned short GetListenPort();
 bool BindListenPort(const CService &bindAddr, std::string &strError, bool fWhitelisted = false);
 void StartNode(thread_group &threadGroup);
 bool StopNode();
-int SocketSendData(CNode *pnode);
+/** Send as much of pnode's queued data as the socket and send shaper allow.  If pfWouldBlock is given it is set to
+    true when the socket's send buffer is full. Requires cs_vSend. */
+int SocketSendData(CNode *pnode, bool *pfWouldBlock = nullptr);
+
+/** Activity of one socket handler thread, reported by getnetworkinfo */
+struct CSocketHandlerStats
+{
+    unsigned int nThread;
+    //! number of peers pinned to this thread
+    size_t nPeers;
+    uint64_t nBytesRecv;
+    uint64_t nBytesSent;
+    //! number of times this thread has gone around its event loop
+    uint64_t nLoops;
+};
+/** Return the activity of each running socket handler thread */
+std::vector<CSocketHandlerStats> GetSocketHandlerStats();
 
 struct CombinerAll
 {
@@ -277,6 +294,13 @@ public:
         nTime = 0;
     }
 
+    CNetMessage(const CNetMessage &) = default;
+    CNetMessage(CNetMessage &&) = default;
+    CNetMessage &operator=(const CNetMessage &) = default;
+    CNetMessage &operator=(CNetMessage &&) = default;
+    // returns the payload buffer to the network buffer pool
+    ~CNetMessage();
+
     // Returns true if this message has been completely received.  This is determined by checking the message size
     // field in the header against the number of payload bytes in this object.
     bool complete() const
@@ -390,6 +414,17 @@ public:
     std::deque<CSerializeData> vSendMsg;
     CCriticalSection cs_vSend;
 
+    //! Index of the socket handler thread that sends and receives for this node, or -1 if it has none
+    int nSocketShard = -1;
+    // epoll socket backend state.  The readiness flags are remembered from edge triggered notifications until a
+    // recv() or send() returns EWOULDBLOCK, and are only accessed by this node's socket handler thread.
+    bool fSocketRecvReady = false;
+    bool fSocketSendReady = false;
+    //! This node is in its socket handler's list of nodes with outstanding socket work
+    bool fSocketActive = false;
+    //! This node is queued for the socket handler to send data that could not be sent optimistically
+    std::atomic<bool> fSocketWakeup{false};
+
     CCriticalSection csRecvGetData;
     std::deque<CInv> vRecvGetData;
     std::deque<CNetMessage> vRecvMsg;
@@ -428,8 +463,9 @@ public:
     /** The state of being informed by the remote peer of his version information */
     ConnectionStateIncoming state_incoming;
 
-    /** used to make processing serial when version handshake is taking place */
-    CCriticalSection csSerialPhase;
+    /** Set while a message handler thread is processing this node.  Only one thread works on a node at a time so
+        that its messages are processed in the order they were received. */
+    std::atomic<bool> fProcessingMessages{false};
 
     /** the intial xversion message sent in the handshake */
     CCriticalSection cs_xversion;
@@ -741,10 +777,16 @@ public:
     void AbortMessage() UNLOCK_FUNCTION(cs_vSend);
 
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
-    void EndMessage() UNLOCK_FUNCTION(cs_vSend);
+    // pnChecksum, if given, is the already known checksum of the payload
+    void EndMessage(const uint32_t *pnChecksum = nullptr) UNLOCK_FUNCTION(cs_vSend);
 
     void PushVersion();
 
+    /** Send a message whose payload is already serialized.  payload must start with CMessageHeader::HEADER_SIZE
+        bytes of room for the header, followed by the payload itself.  payload is left with an unrelated buffer.
+        pnChecksum, if given, is the payload's checksum so it does not need to be hashed again. */
+    void PushRawMessage(const char *pszCommand, CSerializeData &payload, const uint32_t *pnChecksum = nullptr);
+
 
     void PushMessage(const char *pszCommand)
     {
@@ -104,45 +104,40 @@ void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParam
                 {
                     bool fSend = false;
                     {
-                        LOCK(cs_main);
-                        if (chainActive.Contains(mi))
+                        LOCK(cs_main); // for chainActive
+                        fSend = chainActive.Contains(mi);
+                    }
+                    if (!fSend)
+                    {
+                        static const int nOneMonth = 30 * 24 * 60 * 60;
+                        // To prevent fingerprinting attacks, only send blocks outside of the active
+                        // chain if they are valid, and no more than a month older (both in time, and in
+                        // best equivalent proof of work) than the best header chain we know about.
+                        {
+                            READLOCK(cs_mapBlockIndex);
+                            fSend = mi->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
+                                    (pindexBestHeader.load()->GetBlockTime() - mi->GetBlockTime() < nOneMonth) &&
+                                    (GetBlockProofEquivalentTime(
+                                         *pindexBestHeader, *mi, *pindexBestHeader, consensusParams) < nOneMonth);
+                        }
+                        if (!fSend)
                         {
-                            fSend = true;
+                            LOG(NET, "%s: ignoring request from peer=%s for old block that isn't in the main chain\n",
+                                __func__, pfrom->GetLogName());
                         }
                         else
                         {
-                            static const int nOneMonth = 30 * 24 * 60 * 60;
-                            // To prevent fingerprinting attacks, only send blocks outside of the active
-                            // chain if they are valid, and no more than a month older (both in time, and in
-                            // best equivalent proof of work) than the best header chain we know about.
-                            {
-                                READLOCK(cs_mapBlockIndex);
-                                fSend = mi->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
-                                        (pindexBestHeader.load()->GetBlockTime() - mi->GetBlockTime() < nOneMonth) &&
-                                        (GetBlockProofEquivalentTime(
-                                             *pindexBestHeader, *mi, *pindexBestHeader, consensusParams) < nOneMonth);
-                            }
+                            // BU: don't relay excessive blocks that are not on the active chain
+                            if (mi->nStatus & BLOCK_EXCESSIVE)
+                                fSend = false;
                             if (!fSend)
-                            {
                                 LOG(NET,
-                                    "%s: ignoring request from peer=%s for old block that isn't in the main chain\n",
-                                    __func__, pfrom->GetLogName());
-                            }
-                            else
-                            {
-                                // BU: don't relay excessive blocks that are not on the active chain
-                                if (mi->nStatus & BLOCK_EXCESSIVE)
-                                    fSend = false;
-                                if (!fSend)
-                                    LOG(NET,
-                                        "%s: ignoring request from peer=%s for excessive block of height %d not on "
-                                        "the main chain\n",
-                                        __func__, pfrom->GetLogName(), mi->nHeight);
-                            }
-                            // BU: in the future we can throttle old block requests by setting send=false if we are out
-                            // of
-                            // bandwidth
+                                    "%s: ignoring request from peer=%s for excessive block of height %d not on the "
+                                    "main chain\n",
+                                    __func__, pfrom->GetLogName(), mi->nHeight);
                         }
+                        // BU: in the future we can throttle old block requests by setting send=false if we are out of
+                        // bandwidth
                     }
                     // disconnect node in case we have reached the outbound limit for serving historical blocks
                     // never disconnect whitelisted nodes
@@ -179,27 +174,42 @@ void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParam
                     if (fSend && mi->nStatus & BLOCK_HAVE_DATA)
                     {
                         // Send block from disk
-                        CBlock block;
-                        if (!ReadBlockFromDisk(block, mi, consensusParams))
+                        bool fRead = false;
+                        if (inv.type == MSG_BLOCK)
                         {
-                            // its possible that I know about it but haven't stored it yet
-                            LOG(THIN, "unable to load block %s from disk\n",
-                                mi->phashBlock ? mi->phashBlock->ToString() : "");
-                            // no response
+                            fRead = recentblocks.PushBlock(pfrom, inv.hash);
+                            if (!fRead)
+                            {
+                                // A full block goes out exactly as it is stored, so send the raw bytes rather than
+                                // deserializing the block only to serialize it again.
+                                CSerializeData vBlock;
+                                fRead = ReadRawBlockFromDisk(
+                                    vBlock, CMessageHeader::HEADER_SIZE, mi, Params().MessageStart());
+                                if (fRead)
+                                {
+                                    // Blocks near the tip are likely to be asked for by other peers as well
+                                    uint32_t nChecksum = 0;
+                                    const CBlockIndex *pindexBest = pindexBestHeader.load();
+                                    bool fRecent = pindexBest && mi->nHeight + (int)RECENT_BLOCK_CACHE_SIZE >
+                                                                     pindexBest->nHeight;
+                                    if (fRecent)
+                                        nChecksum = recentblocks.Add(inv.hash, vBlock);
+                                    pfrom->PushRawMessage(NetMsgType::BLOCK, vBlock, fRecent ? &nChecksum : nullptr);
+                                }
+                            }
+                            if (fRead)
+                                pfrom->blocksSent += 1;
                         }
                         else
                         {
-                            if (inv.type == MSG_BLOCK)
-                            {
-                                pfrom->blocksSent += 1;
-                                pfrom->PushMessage(NetMsgType::BLOCK, block);
-                            }
-                            else if (inv.type == MSG_CMPCT_BLOCK)
+                            CBlock block;
+                            fRead = ReadBlockFromDisk(block, mi, consensusParams);
+                            if (fRead && inv.type == MSG_CMPCT_BLOCK)
                             {
                                 LOG(CMPCT, "Sending compactblock via getdata message\n");
                                 SendCompactBlock(MakeBlockRef(block), pfrom, inv);
                             }
-                            else // MSG_FILTERED_BLOCK)
+                            else if (fRead) // MSG_FILTERED_BLOCK)
                             {
                                 LOCK(pfrom->cs_filter);
                                 if (pfrom->pfilter)
@@ -226,7 +236,17 @@ void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParam
                                 // else
                                 // no response
                             }
+                        }
 
+                        if (!fRead)
+                        {
+                            // its possible that I know about it but haven't stored it yet
+                            LOG(THIN, "unable to load block %s from disk\n",
+                                mi->phashBlock ? mi->phashBlock->ToString() : "");
+                            // no response
+                        }
+                        else
+                        {
                             // Trigger the peer node to send a getblocks request for the next batch of inventory
                             if (inv.hash == pfrom->hashContinue)
                             {
@@ -957,7 +977,6 @@ bool ProcessMessage(CNode *pfrom, std::string strCommand, CDataStream &vRecv, in
 
             if (inv.type == MSG_BLOCK)
             {
-                LOCK(cs_main);
                 bool fAlreadyHaveBlock = AlreadyHaveBlock(inv);
                 LOG(NET, "got inv: %s  %s peer=%d\n", inv.ToString(), fAlreadyHaveBlock ? "have" : "new", pfrom->id);
 
@@ -977,7 +996,12 @@ bool ProcessMessage(CNode *pfrom, std::string strCommand, CDataStream &vRecv, in
                     // we will instead request the header rather than the block.  This is safer and prevents an
                     // attacker from sending us fake INV's for blocks that do not exist or try to get us to request
                     // and download fake blocks.
-                    pfrom->PushMessage(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), inv.hash);
+                    CBlockLocator locator;
+                    {
+                        LOCK(cs_main); // for chainActive
+                        locator = chainActive.GetLocator(pindexBestHeader);
+                    }
+                    pfrom->PushMessage(NetMsgType::GETHEADERS, locator, inv.hash);
                 }
                 else
                 {
@@ -1083,48 +1107,55 @@ bool ProcessMessage(CNode *pfrom, std::string strCommand, CDataStream &vRecv, in
         uint256 hashStop;
         vRecv >> locator >> hashStop;
 
-        LOCK(cs_main);
+        // Only walk the chain under cs_main, announcing the blocks does not need it
+        std::vector<CInv> vInv;
+        {
+            LOCK(cs_main);
 
-        // Find the last block the caller has in the main chain
-        CBlockIndex *pindex = FindForkInGlobalIndex(chainActive, locator);
+            // Find the last block the caller has in the main chain
+            CBlockIndex *pindex = FindForkInGlobalIndex(chainActive, locator);
 
-        // Send the rest of the chain
-        if (pindex)
-            pindex = chainActive.Next(pindex);
-        int nLimit = 500;
-        LOG(NET, "getblocks %d to %s limit %d from peer=%d\n", (pindex ? pindex->nHeight : -1),
-            hashStop.IsNull() ? "end" : hashStop.ToString(), nLimit, pfrom->id);
-        for (; pindex; pindex = chainActive.Next(pindex))
-        {
-            if (pindex->GetBlockHash() == hashStop)
-            {
-                LOG(NET, "  getblocks stopping at %d %s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-                break;
-            }
-            // If pruning, don't inv blocks unless we have on disk and are likely to still have
-            // for some reasonable time window (1 hour) that block relay might require.
-            const int nPrunedBlocksLikelyToHave =
-                MIN_BLOCKS_TO_KEEP - 3600 / chainparams.GetConsensus().nPowTargetSpacing;
+            // Send the rest of the chain
+            if (pindex)
+                pindex = chainActive.Next(pindex);
+            int nLimit = 500;
+            LOG(NET, "getblocks %d to %s limit %d from peer=%d\n", (pindex ? pindex->nHeight : -1),
+                hashStop.IsNull() ? "end" : hashStop.ToString(), nLimit, pfrom->id);
+            for (; pindex; pindex = chainActive.Next(pindex))
             {
-                READLOCK(cs_mapBlockIndex); // for nStatus
-                if (fPruneMode && (!(pindex->nStatus & BLOCK_HAVE_DATA) ||
-                                      pindex->nHeight <= chainActive.Tip()->nHeight - nPrunedBlocksLikelyToHave))
+                if (pindex->GetBlockHash() == hashStop)
                 {
-                    LOG(NET, " getblocks stopping, pruned or too old block at %d %s\n", pindex->nHeight,
+                    LOG(NET, "  getblocks stopping at %d %s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                    break;
+                }
+                // If pruning, don't inv blocks unless we have on disk and are likely to still have
+                // for some reasonable time window (1 hour) that block relay might require.
+                const int nPrunedBlocksLikelyToHave =
+                    MIN_BLOCKS_TO_KEEP - 3600 / chainparams.GetConsensus().nPowTargetSpacing;
+                {
+                    READLOCK(cs_mapBlockIndex); // for nStatus
+                    if (fPruneMode && (!(pindex->nStatus & BLOCK_HAVE_DATA) ||
+                                          pindex->nHeight <= chainActive.Tip()->nHeight - nPrunedBlocksLikelyToHave))
+                    {
+                        LOG(NET, " getblocks stopping, pruned or too old block at %d %s\n", pindex->nHeight,
+                            pindex->GetBlockHash().ToString());
+                        break;
+                    }
+                }
+                vInv.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
+                if (--nLimit <= 0)
+                {
+                    // When this block is requested, we'll send an inv that'll
+                    // trigger the peer to getblocks the next batch of inventory.
+                    LOG(NET, "  getblocks stopping at limit %d %s\n", pindex->nHeight,
                         pindex->GetBlockHash().ToString());
+                    pfrom->hashContinue = pindex->GetBlockHash();
                     break;
                 }
             }
-            pfrom->PushInventory(CInv(MSG_BLOCK, pindex->GetBlockHash()));
-            if (--nLimit <= 0)
-            {
-                // When this block is requested, we'll send an inv that'll
-                // trigger the peer to getblocks the next batch of inventory.
-                LOG(NET, "  getblocks stopping at limit %d %s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-                pfrom->hashContinue = pindex->GetBlockHash();
-                break;
-            }
         }
+        for (const CInv &inv : vInv)
+            pfrom->PushInventory(inv);
     }
 
 
@@ -2062,7 +2093,7 @@ bool ProcessMessages(CNode *pfrom)
                 // msgOnQ.nDataPos, msgOnQ.size(), pfrom->currentRecvMsgSize.value);
                 break;
             }
-            msg = msgOnQ;
+            msg = std::move(msgOnQ);
             // at this point, any failure means we can delete the current message
             pfrom->vRecvMsg.pop_front();
             pfrom->currentRecvMsgSize -= msg.size();
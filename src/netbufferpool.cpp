@@ -0,0 +1,102 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netbufferpool.h"
+
+static_assert((NET_BUFFER_MIN_CLASS_SIZE << 14) == NET_BUFFER_MAX_CLASS_SIZE, "NUM_CLASSES does not match the limits");
+
+CNetBufferPool::CNetBufferPool()
+    : hits("net/bufferPool/hits"), misses("net/bufferPool/misses"), discards("net/bufferPool/discards")
+{
+}
+
+size_t CNetBufferPool::ClassForSize(size_t nSize)
+{
+    size_t nClass = 0;
+    while (nClass < NUM_CLASSES && ClassSize(nClass) < nSize)
+        nClass++;
+    return nClass;
+}
+
+size_t CNetBufferPool::ClassForCapacity(size_t nCapacity)
+{
+    if (nCapacity < NET_BUFFER_MIN_CLASS_SIZE)
+        return NUM_CLASSES;
+    size_t nClass = 0;
+    while (nClass + 1 < NUM_CLASSES && ClassSize(nClass + 1) <= nCapacity)
+        nClass++;
+    return nClass;
+}
+
+size_t CNetBufferPool::MaxIdle(size_t nClass)
+{
+    return std::max((size_t)4, std::min(NET_BUFFER_MAX_CLASS_COUNT, NET_BUFFER_CLASS_BYTES / ClassSize(nClass)));
+}
+
+void CNetBufferPool::Get(CSerializeData &buf, size_t nSize)
+{
+    size_t nClass = ClassForSize(nSize);
+    {
+        LOCK(cs_pool);
+        // A buffer from a bigger class would do as well, but handing those out would leave the pool short of big
+        // buffers when a block needs to be sent.
+        if (nClass < NUM_CLASSES && !vFree[nClass].empty())
+        {
+            buf.swap(vFree[nClass].back());
+            vFree[nClass].pop_back();
+            hits += 1;
+            return;
+        }
+        misses += 1;
+    }
+
+    CSerializeData fresh;
+    fresh.reserve(nClass < NUM_CLASSES ? ClassSize(nClass) : nSize);
+    buf.swap(fresh);
+}
+
+void CNetBufferPool::Put(CSerializeData &buf)
+{
+    if (buf.capacity() == 0)
+        return;
+
+    size_t nClass = ClassForCapacity(buf.capacity());
+    buf.clear();
+    {
+        LOCK(cs_pool);
+        // Don't hold on to buffers much bigger than their class, a single huge block would pin its memory forever
+        if (nClass < NUM_CLASSES && buf.capacity() <= 2 * ClassSize(nClass) && vFree[nClass].size() < MaxIdle(nClass))
+        {
+            vFree[nClass].emplace_back();
+            vFree[nClass].back().swap(buf);
+            return;
+        }
+        discards += 1;
+    }
+    // free outside of the lock since this cleanses the memory
+    CSerializeData().swap(buf);
+}
+
+size_t CNetBufferPool::Idle()
+{
+    LOCK(cs_pool);
+    size_t nIdle = 0;
+    for (size_t i = 0; i < NUM_CLASSES; i++)
+        nIdle += vFree[i].size();
+    return nIdle;
+}
+
+void CNetBufferPool::Clear()
+{
+    LOCK(cs_pool);
+    for (size_t i = 0; i < NUM_CLASSES; i++)
+        std::vector<CSerializeData>().swap(vFree[i]);
+}
+
+void CNetBufferPool::Stop()
+{
+    hits.Stop();
+    misses.Stop();
+    discards.Stop();
+}
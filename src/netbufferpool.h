@@ -0,0 +1,75 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NETBUFFERPOOL_H
+#define BITCOIN_NETBUFFERPOOL_H
+
+#include "stat.h"
+#include "streams.h"
+#include "sync.h"
+
+#include <vector>
+
+/** The smallest buffer size class, smaller requests are rounded up to this */
+static const size_t NET_BUFFER_MIN_CLASS_SIZE = 256;
+/** The largest buffer size class.  Bigger buffers are allocated and freed normally. */
+static const size_t NET_BUFFER_MAX_CLASS_SIZE = 4 * 1024 * 1024;
+/** The number of bytes the pool may keep idle in each size class */
+static const size_t NET_BUFFER_CLASS_BYTES = 8 * 1024 * 1024;
+/** Never keep more than this many idle buffers in any size class */
+static const size_t NET_BUFFER_MAX_CLASS_COUNT = 1024;
+/** Outgoing messages at least this big are moved into the send queue instead of copied into a pooled buffer */
+static const size_t MIN_SEND_SWAP_SIZE = 256 * 1024;
+
+/** A pool of network message buffers, recycled by power of two size class.
+
+    Every message sent or received needs a buffer that used to be allocated, and then cleansed and freed by the
+    zero_after_free_allocator once the message was handled.  Network messages hold nothing secret, so the pool
+    hands their buffers out again instead, skipping both the allocation and the cleanse.
+
+    The buffers are ordinary CSerializeData so they can be swapped in and out of CDataStream and CNode::vSendMsg
+    without copying.
+ */
+class CNetBufferPool
+{
+protected:
+    static const size_t NUM_CLASSES = 15; // 256 bytes to 4MB
+
+    CCriticalSection cs_pool;
+    std::vector<CSerializeData> vFree[NUM_CLASSES] GUARDED_BY(cs_pool);
+
+    /** Return the smallest size class whose buffers hold nSize bytes, or NUM_CLASSES if there is none */
+    static size_t ClassForSize(size_t nSize);
+    /** Return the largest size class a buffer with nCapacity bytes can serve, or NUM_CLASSES if there is none */
+    static size_t ClassForCapacity(size_t nCapacity);
+    static size_t ClassSize(size_t nClass) { return NET_BUFFER_MIN_CLASS_SIZE << nClass; }
+    static size_t MaxIdle(size_t nClass);
+
+public:
+    //! requests served with a recycled buffer
+    CStatHistory<uint64_t> hits;
+    //! requests that needed a new allocation
+    CStatHistory<uint64_t> misses;
+    //! buffers that were freed because they did not fit in the pool
+    CStatHistory<uint64_t> discards;
+
+    CNetBufferPool();
+
+    /** Replace buf (which should be empty) with an empty buffer that can hold at least nSize bytes */
+    void Get(CSerializeData &buf, size_t nSize);
+    /** Return buf's memory to the pool, leaving buf empty */
+    void Put(CSerializeData &buf);
+
+    /** The number of idle buffers held by the pool */
+    size_t Idle();
+    /** Free every idle buffer */
+    void Clear();
+
+    /** Stop the statistics timers before shutdown */
+    void Stop();
+};
+
+extern CNetBufferPool netBufferPool;
+
+#endif // BITCOIN_NETBUFFERPOOL_H
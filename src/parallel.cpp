@@ -9,6 +9,7 @@
 #include "blockrelay/graphene.h"
 #include "blockstorage/blockstorage.h"
 #include "chainparams.h"
+#include "consensus/merkle.h"
 #include "dosman.h"
 #include "net.h"
 #include "pow.h"
@@ -43,18 +44,103 @@ static void AddScriptCheckThreads(int i, CCheckQueue<CScriptCheck> *pqueue)
     pqueue->Thread();
 }
 
+// The batch of the script check queue worker running on this thread, if Schnorr signatures are being batched
+static thread_local CCheckQueueBatch<CScriptCheck> *pThreadBatch = nullptr;
+
+void CCheckQueueBatch<CScriptCheck>::Begin()
+{
+    if (schnorrBatchVerify.Value())
+        pThreadBatch = this;
+}
+
+bool CCheckQueueBatch<CScriptCheck>::End(bool fOk)
+{
+    pThreadBatch = nullptr;
+    if (fOk && !schnorrBatch.empty() && !schnorrBatch.Verify())
+    {
+        int nInvalid = schnorrBatch.FindInvalid();
+        if (nInvalid >= 0)
+        {
+            LOG(PARALLEL, "Invalid Schnorr signature in batch, tx %s input %d\n",
+                vOrigins[nInvalid].first.ToString(), vOrigins[nInvalid].second);
+            fOk = false;
+        }
+    }
+    schnorrBatch.clear();
+    vOrigins.clear();
+    return fOk;
+}
+
 bool CScriptCheck::operator()()
 {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
-    CachingTransactionSignatureChecker checker(ptxTo, nIn, amount, nFlags, cacheStore);
+    CSchnorrBatch *pSchnorrBatch = pThreadBatch ? &pThreadBatch->schnorrBatch : nullptr;
+    CachingTransactionSignatureChecker checker(ptxTo, nIn, amount, nFlags, cacheStore, pSchnorrBatch);
     if (!VerifyScript(scriptSig, scriptPubKey, nFlags, maxOps, checker, &error, &sighashType))
         return false;
+    if (pSchnorrBatch)
+        pThreadBatch->vOrigins.resize(pSchnorrBatch->size(), std::make_pair(ptxTo->GetHash(), nIn));
     if (resourceTracker)
         resourceTracker->Update(ptxTo->GetHash(), checker.GetNumSigops(), checker.GetBytesHashed());
     return true;
 }
 
-CParallelValidation::CParallelValidation() : nThreads(0), semThreadCount(nScriptCheckQueues)
+static void AddMerkleCheckThreads(int i, CCheckQueue<CMerkleCheck> *pqueue)
+{
+    ostringstream tName;
+    tName << "merklechk" << i;
+    RenameThread(tName.str().c_str());
+    pqueue->Thread();
+}
+
+bool CMerkleCheck::operator()()
+{
+    std::vector<uint256> vHashes(nCount);
+    for (size_t i = 0; i < nCount; i++)
+        vHashes[i] = pblock->vtx[nBegin + i]->GetHash();
+
+    bool mutated = false;
+    ComputeMerkleSubtree(vHashes.data(), vHashes.size(), MERKLE_SUBTREE_LEVELS, &mutated);
+    *pRoot = vHashes[0];
+    return !mutated;
+}
+
+static void AddPrefetchThreads(int i, CCheckQueue<CPrefetchCheck> *pqueue)
+{
+    ostringstream tName;
+    tName << "prefetch" << i;
+    RenameThread(tName.str().c_str());
+    pqueue->Thread();
+}
+
+bool CPrefetchCheck::operator()()
+{
+    int64_t nStart = GetStopwatchMicros();
+    uint64_t nLoaded = 0;
+    uint64_t nCached = 0;
+    uint64_t nMissing = 0;
+    for (size_t i = nBegin; i < nEnd; i++)
+    {
+        for (const CTxIn &txin : pblock->vtx[i]->vin)
+        {
+            bool fSpent = false;
+            if (pcoinsTip->HaveCoinInCache(txin.prevout, fSpent))
+                nCached++;
+            else if (pcoinsTip->HaveCoin(txin.prevout))
+                nLoaded++;
+            else
+                nMissing++;
+        }
+    }
+    nPrefetchLoaded << nLoaded;
+    nPrefetchCached << nCached;
+    nPrefetchMissing << nMissing;
+    *pnWorkTime += GetStopwatchMicros() - nStart;
+    return true;
+}
+
+CParallelValidation::CParallelValidation()
+    : pMerkleQueue(nullptr), pPrefetchQueue(nullptr), nThreads(0), semThreadCount(nScriptCheckQueues)
 {
     // There are nScriptCheckQueues which are used to validate blocks in parallel. Each block
     // that validates will use one script check queue which must *not* be shared with any other
@@ -85,15 +171,33 @@ CParallelValidation::CParallelValidation() : nThreads(0), semThreadCount(nScript
         }
         vQueues.push_back(queue);
     }
+
+    // The merkle subtrees of a large block are few and each one is a lot of work, so they are handed out one at a
+    // time.
+    pMerkleQueue = new CCheckQueue<CMerkleCheck>(1);
+    for (unsigned int i = 0; i < nThreads; i++)
+    {
+        threadGroup.create_thread(boost::bind(&AddMerkleCheckThreads, i + 1, pMerkleQueue));
+    }
+
+    pPrefetchQueue = new CCheckQueue<CPrefetchCheck>(1);
+    for (unsigned int i = 0; i < nThreads; i++)
+    {
+        threadGroup.create_thread(boost::bind(&AddPrefetchThreads, i + 1, pPrefetchQueue));
+    }
 }
 
 CParallelValidation::~CParallelValidation()
 {
     for (auto queue : vQueues)
         queue->Shutdown();
+    pMerkleQueue->Shutdown();
+    pPrefetchQueue->Shutdown();
     threadGroup.join_all();
     for (auto queue : vQueues)
         delete queue;
+    delete pMerkleQueue;
+    delete pPrefetchQueue;
 }
 
 unsigned int CParallelValidation::QueueCount()
@@ -579,6 +683,9 @@ void HandleBlockMessageThread(CNode *pfrom, const string strCommand, CBlockRef p
 
         PV->InitThread(this_id, pfrom, pblock, inv, nSizeBlock); // initialize the mapBlockValidationThread entries
 
+        // Warm the coins cache before taking any locks, so that validating the block does not wait on the database
+        PV->PrefetchCoins(*pblock);
+
         // Process all blocks from whitelisted peers, even if not requested,
         // unless we're still syncing with the network.
         // Such an unrequested block may still be processed, subject to the
@@ -715,3 +822,62 @@ CCheckQueue<CScriptCheck> *CParallelValidation::GetScriptCheckQueue()
         MilliSleep(50);
     }
 }
+
+uint256 CParallelValidation::BlockMerkleRoot(const CBlock &block, bool *mutated)
+{
+    const size_t nLeaves = block.vtx.size();
+    const size_t nSubtreeLeaves = (size_t)1 << MERKLE_SUBTREE_LEVELS;
+    if (nThreads == 0 || nLeaves <= nSubtreeLeaves)
+        return ::BlockMerkleRoot(block, mutated);
+
+    // Only one block at a time can use the merkle check queue, any others just do it themselves.
+    TRY_LOCK(cs_merklequeue, lockMerkle);
+    if (!lockMerkle)
+        return ::BlockMerkleRoot(block, mutated);
+
+    std::vector<uint256> vRoots((nLeaves + nSubtreeLeaves - 1) / nSubtreeLeaves);
+    std::vector<CMerkleCheck> vChecks;
+    vChecks.reserve(vRoots.size());
+    for (size_t i = 0; i < vRoots.size(); i++)
+    {
+        size_t nBegin = i * nSubtreeLeaves;
+        vChecks.emplace_back(block, nBegin, std::min(nSubtreeLeaves, nLeaves - nBegin), &vRoots[i]);
+    }
+
+    CCheckQueueControl<CMerkleCheck> control(pMerkleQueue);
+    control.Add(vChecks);
+    if (!control.Wait())
+    {
+        // A mutated subtree makes the block invalid, so this is not worth doing quickly.
+        return ::BlockMerkleRoot(block, mutated);
+    }
+    return ComputeMerkleRoot(std::move(vRoots), mutated);
+}
+
+bool CParallelValidation::PrefetchCoins(const CBlock &block)
+{
+    // There is nothing to load for a block holding only a coinbase
+    if (nThreads == 0 || !prefetchCoins.Value() || block.vtx.size() < 2)
+        return false;
+
+    TRY_LOCK(cs_prefetchqueue, lockPrefetch);
+    if (!lockPrefetch)
+        return false;
+
+    int64_t nStart = GetStopwatchMicros();
+    std::atomic<int64_t> nWorkTime{0};
+    std::vector<CPrefetchCheck> vChecks;
+    for (size_t i = 1; i < block.vtx.size(); i += PREFETCH_TXNS_PER_CHECK)
+        vChecks.emplace_back(block, i, std::min(i + PREFETCH_TXNS_PER_CHECK, block.vtx.size()), &nWorkTime);
+
+    CCheckQueueControl<CPrefetchCheck> control(pPrefetchQueue);
+    control.Add(vChecks);
+    control.Wait();
+
+    int64_t nElapsed = GetStopwatchMicros() - nStart;
+    if (nWorkTime > nElapsed)
+        nPrefetchTimeSaved << nWorkTime - nElapsed;
+    LOG(PARALLEL, "Prefetched coins for block %s in %d us, %d us on the prefetch threads\n", block.GetHash().ToString(),
+        nElapsed, nWorkTime.load());
+    return true;
+}
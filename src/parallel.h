@@ -10,14 +10,29 @@
 #include "main.h"
 #include "primitives/block.h"
 #include "protocol.h"
+#include "pubkey.h"
 #include "serialize.h"
 #include "stat.h"
+#include "tweak.h"
 #include "uint256.h"
 #include "util.h"
 #include <vector>
 
+#include <atomic>
 #include <thread>
 
+extern CTweak<bool> schnorrBatchVerify;
+extern CTweak<bool> prefetchCoins;
+
+//! Coins that the prefetch stage read from the database
+extern CStatHistory<uint64_t> nPrefetchLoaded;
+//! Coins that the prefetch stage found already cached
+extern CStatHistory<uint64_t> nPrefetchCached;
+//! Coins that the prefetch stage did not find, mostly those created earlier in the same block
+extern CStatHistory<uint64_t> nPrefetchMissing;
+//! Estimated microseconds saved by reading coins in parallel: the prefetch threads' total time less the elapsed time
+extern CStatHistory<uint64_t> nPrefetchTimeSaved;
+
 /**
  * Class that keeps track of number of signature operations
  * and bytes hashed to compute signature hashes.
@@ -108,6 +123,91 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * When parallel.schnorrBatchVerify is on, the Schnorr signatures of the script checks that a worker runs are
+ * collected and verified together once the worker's batch of checks is done.  If the batch does not verify then
+ * the signatures are checked one at a time to find out which one, if any, is invalid.
+ */
+template <>
+class CCheckQueueBatch<CScriptCheck>
+{
+public:
+    CSchnorrBatch schnorrBatch;
+    //! the transaction and input that each signature in schnorrBatch came from
+    std::vector<std::pair<uint256, unsigned int> > vOrigins;
+
+    void Begin();
+    bool End(bool fOk);
+};
+
+/** The merkle tree of a large block is split into subtrees of 2^MERKLE_SUBTREE_LEVELS leaves which are hashed in
+ *  parallel.  Smaller blocks are hashed on the calling thread. */
+static const int MERKLE_SUBTREE_LEVELS = 12;
+
+/**
+ * Closure computing the root of one subtree of a block's merkle tree, from the hashes of the transactions in it.
+ * Note that this stores a reference to the block
+ */
+class CMerkleCheck
+{
+private:
+    const CBlock *pblock;
+    size_t nBegin;
+    size_t nCount;
+    uint256 *pRoot;
+
+public:
+    CMerkleCheck() : pblock(nullptr), nBegin(0), nCount(0), pRoot(nullptr) {}
+    CMerkleCheck(const CBlock &blockIn, size_t nBeginIn, size_t nCountIn, uint256 *pRootIn)
+        : pblock(&blockIn), nBegin(nBeginIn), nCount(nCountIn), pRoot(pRootIn)
+    {
+    }
+
+    /** Returns false if the subtree is mutated (see consensus/merkle.cpp) */
+    bool operator()();
+
+    void swap(CMerkleCheck &check)
+    {
+        std::swap(pblock, check.pblock);
+        std::swap(nBegin, check.nBegin);
+        std::swap(nCount, check.nCount);
+        std::swap(pRoot, check.pRoot);
+    }
+};
+
+/** The number of transactions whose coins one prefetch check loads */
+static const size_t PREFETCH_TXNS_PER_CHECK = 64;
+
+/**
+ * Closure loading the coins spent by a range of a block's transactions into pcoinsTip, so that the database reads
+ * are done in parallel before the block is connected rather than one at a time while it is.
+ */
+class CPrefetchCheck
+{
+private:
+    const CBlock *pblock;
+    size_t nBegin;
+    size_t nEnd;
+    std::atomic<int64_t> *pnWorkTime;
+
+public:
+    CPrefetchCheck() : pblock(nullptr), nBegin(0), nEnd(0), pnWorkTime(nullptr) {}
+    CPrefetchCheck(const CBlock &blockIn, size_t nBeginIn, size_t nEndIn, std::atomic<int64_t> *pnWorkTimeIn)
+        : pblock(&blockIn), nBegin(nBeginIn), nEnd(nEndIn), pnWorkTime(pnWorkTimeIn)
+    {
+    }
+
+    bool operator()();
+
+    void swap(CPrefetchCheck &check)
+    {
+        std::swap(pblock, check.pblock);
+        std::swap(nBegin, check.nBegin);
+        std::swap(nEnd, check.nEnd);
+        std::swap(pnWorkTime, check.pnWorkTime);
+    }
+};
+
 class CParallelValidation
 {
 private:
@@ -116,6 +216,12 @@ private:
     std::vector<uint256> vPreviousBlock;
     /** Vector of script check queues */
     std::vector<CCheckQueue<CScriptCheck> *> vQueues;
+    /** Queue for the merkle subtrees of large blocks, shared by all the blocks being checked */
+    CCriticalSection cs_merklequeue;
+    CCheckQueue<CMerkleCheck> *pMerkleQueue;
+    /** Queue for loading the coins of a block before it is validated, shared by all the blocks */
+    CCriticalSection cs_prefetchqueue;
+    CCheckQueue<CPrefetchCheck> *pPrefetchQueue;
     /** Number of threads */
     unsigned int nThreads;
     /** All threads currently running */
@@ -223,6 +329,19 @@ public:
 
     /** For newly mined block validation, return the first queue not in use. */
     CCheckQueue<CScriptCheck> *GetScriptCheckQueue();
+
+    /**
+     * Compute the merkle root of a block, as BlockMerkleRoot does.  The subtrees of a large block are hashed on the
+     * merkle check threads, unless there are none or they are busy with another block.
+     */
+    uint256 BlockMerkleRoot(const CBlock &block, bool *mutated = nullptr);
+
+    /**
+     * Load the coins that the block spends into pcoinsTip using the prefetch threads, and wait for them to finish.
+     * Nothing is done if there are no threads, the parallel.prefetchCoins tweak is off, or another block's coins are
+     * being loaded.  Returns true if the coins were loaded.
+     */
+    bool PrefetchCoins(const CBlock &block);
 };
 
 extern std::unique_ptr<CParallelValidation> PV; // Singleton class
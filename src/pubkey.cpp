@@ -373,6 +373,61 @@ bool CExtPubKey::Derive(CExtPubKey &out, unsigned int _nChild) const
     return (!secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, NULL, &sig));
 }
 
+void CSchnorrBatch::Add(const CPubKey &pubkey, const uint256 &hash, const std::vector<uint8_t> &vchSig)
+{
+    assert(vchSig.size() == 64);
+    vPubKeys.push_back(pubkey);
+    vHashes.push_back(hash);
+    vSigs.insert(vSigs.end(), vchSig.begin(), vchSig.end());
+}
+
+void CSchnorrBatch::clear()
+{
+    vPubKeys.clear();
+    vHashes.clear();
+    vSigs.clear();
+}
+
+bool CSchnorrBatch::Verify() const
+{
+    // Enough for the multi-multiplication of a few hundred signatures at once, bigger batches are done in pieces
+    static const size_t SCRATCH_SIZE = 1024 * 1024;
+
+    const size_t nSigs = size();
+    std::vector<secp256k1_pubkey> vParsed(nSigs);
+    std::vector<const secp256k1_pubkey *> vpPubKeys(nSigs);
+    std::vector<const unsigned char *> vpHashes(nSigs);
+    std::vector<const unsigned char *> vpSigs(nSigs);
+    for (size_t i = 0; i < nSigs; i++)
+    {
+        const CPubKey &pubkey = vPubKeys[i];
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &vParsed[i], &pubkey[0], pubkey.size()))
+            return false;
+        vpPubKeys[i] = &vParsed[i];
+        vpHashes[i] = vHashes[i].begin();
+        vpSigs[i] = &vSigs[64 * i];
+    }
+
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(secp256k1_context_verify, SCRATCH_SIZE);
+    if (!scratch)
+        return false;
+    bool fValid = secp256k1_schnorr_verify_batch(
+        secp256k1_context_verify, scratch, vpSigs.data(), vpHashes.data(), vpPubKeys.data(), nSigs);
+    secp256k1_scratch_space_destroy(scratch);
+    return fValid;
+}
+
+int CSchnorrBatch::FindInvalid() const
+{
+    for (size_t i = 0; i < size(); i++)
+    {
+        std::vector<uint8_t> vchSig(vSigs.begin() + 64 * i, vSigs.begin() + 64 * (i + 1));
+        if (!vPubKeys[i].VerifySchnorr(vHashes[i], vchSig))
+            return i;
+    }
+    return -1;
+}
+
 /* static */ int ECCVerifyHandle::refcount = 0;
 
 ECCVerifyHandle::ECCVerifyHandle()
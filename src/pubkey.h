@@ -175,6 +175,28 @@ public:
     bool Derive(CPubKey &pubkeyChild, ChainCode &ccChild, unsigned int nChild, const ChainCode &cc) const;
 };
 
+/** Schnorr signatures collected so that they can be verified together, which is quicker than one at a time */
+class CSchnorrBatch
+{
+private:
+    std::vector<CPubKey> vPubKeys;
+    std::vector<uint256> vHashes;
+    std::vector<uint8_t> vSigs; // 64 bytes each
+
+public:
+    /** Add a signature to check.  The caller must make sure that pubkey is valid and vchSig is 64 bytes. */
+    void Add(const CPubKey &pubkey, const uint256 &hash, const std::vector<uint8_t> &vchSig);
+    size_t size() const { return vHashes.size(); }
+    bool empty() const { return vHashes.empty(); }
+    void clear();
+
+    /** Return true if every signature in the batch is valid.  False does not always mean that one is invalid,
+        the batch may also have been too big to verify at once; FindInvalid() tells for sure. */
+    bool Verify() const;
+    /** Verify the signatures one at a time, and return the index of the first invalid one or -1 if there is none */
+    int FindInvalid() const;
+};
+
 struct CExtPubKey
 {
     unsigned char nDepth;
@@ -28,6 +28,8 @@
 #include "undo.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "utxosnapshot.h"
+#include "utxostats.h"
 #include "validation/validation.h"
 #include "validation/verifydb.h"
 
@@ -737,41 +739,15 @@ static UniValue getblock(const UniValue &params, bool fHelp)
     return blockToJSON(block, pblockindex, false, fListTxns);
 }
 
-static void ApplyStats(CCoinsStats &stats,
-    CHashWriter &ss,
-    const uint256 &hash,
-    const std::map<uint32_t, Coin> &outputs)
-{
-    DbgAssert(!outputs.empty(), throw std::runtime_error(__func__));
-    ss << hash;
-    ss << VARINT(
-        outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase, VarIntMode::NONNEGATIVE_SIGNED);
-    stats.nTransactions++;
-    for (const auto output : outputs)
-    {
-        ss << VARINT(output.first + 1);
-        ss << *(const CScriptBase *)(&output.second.out.scriptPubKey);
-        ss << VARINT(output.second.out.nValue, VarIntMode::NONNEGATIVE_SIGNED);
-        stats.nTransactionOutputs++;
-        stats.nTotalAmount += output.second.out.nValue;
-    }
-    ss << VARINT(0u);
-}
-
 //! Calculate statistics about the unspent transaction output set
 static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
 {
     std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
     DbgAssert(pcursor, throw std::runtime_error(__func__));
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
-
+    CCoinsStatsHasher hasher(stats, pcursor->GetBestBlock());
     CBlockIndex *pindex = LookupBlockIndex(stats.hashBlock);
     stats.nHeight = pindex->nHeight;
-    ss << stats.hashBlock;
-    uint256 prevkey;
-    std::map<uint32_t, Coin> outputs;
     while (pcursor->Valid())
     {
         boost::this_thread::interruption_point();
@@ -779,13 +755,7 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
         Coin coin;
         if (pcursor->GetKey(key) && pcursor->GetValue(coin))
         {
-            if (!outputs.empty() && key.hash != prevkey)
-            {
-                ApplyStats(stats, ss, prevkey, outputs);
-                outputs.clear();
-            }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
+            hasher.Add(key, std::move(coin));
         }
         else
         {
@@ -793,11 +763,7 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
         }
         pcursor->Next();
     }
-    if (!outputs.empty())
-    {
-        ApplyStats(stats, ss, prevkey, outputs);
-    }
-    stats.hashSerialized = ss.GetHash();
+    hasher.Finalize();
     stats.nDiskSize = view->EstimateSize();
     return true;
 }
@@ -805,40 +771,123 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
 
 UniValue gettxoutsetinfo(const UniValue &params, bool fHelp)
 {
-    if (fHelp || params.size() != 0)
-        throw runtime_error("gettxoutsetinfo\n"
-                            "\nReturns statistics about the unspent transaction output set.\n"
-                            "Note this call may take some time.\n"
-                            "\nResult:\n"
-                            "{\n"
-                            "  \"height\":n,     (numeric) The current block height (index)\n"
-                            "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-                            "  \"transactions\": n,      (numeric) The number of transactions\n"
-                            "  \"txouts\": n,            (numeric) The number of output transactions\n"
-                            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
-                            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
-                            "  \"total_amount\": x.xxx          (numeric) The total amount\n"
-                            "}\n"
-                            "\nExamples:\n" +
-                            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleRpc("gettxoutsetinfo", ""));
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "gettxoutsetinfo ( \"hash_type\" )\n"
+            "\nReturns statistics about the unspent transaction output set.\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"  (string, optional, default=muhash) Which statistics to return:\n"
+            "     muhash             the statistics kept up to date as blocks are connected, returned at once\n"
+            "     hash_serialized_2  the serialized hash and transaction count, computed by a scan of the set\n"
+            "     verify             recompute the muhash statistics with a parallel scan of the set and check them\n"
+            "                        against the ones kept up to date\n"
+            "Note hash_serialized_2 and verify may take some time.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"height\":n,     (numeric) The current block height (index)\n"
+            "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
+            "  \"transactions\": n,      (numeric) The number of transactions, for hash_serialized_2 only\n"
+            "  \"txouts\": n,            (numeric) The number of output transactions\n"
+            "  \"hash_serialized_2\": \"hash\",   (string) The serialized hash, for hash_serialized_2 only\n"
+            "  \"muhash\": \"hash\",      (string) The rolling hash of the set, for muhash and verify\n"
+            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
+            "  \"total_amount\": x.xxx,  (numeric) The total amount\n"
+            "  \"verified\": true|false  (boolean) Whether the scan matched the statistics kept up to date, "
+            "for verify only\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleCli("gettxoutsetinfo", "\"verify\"") +
+            HelpExampleRpc("gettxoutsetinfo", ""));
 
+    std::string strType = params.size() > 0 ? params[0].get_str() : "muhash";
     UniValue ret(UniValue::VOBJ);
 
-    CCoinsStats stats;
-    FlushStateToDisk();
-    if (GetUTXOStats(pcoinsdbview, stats))
+    if (strType == "hash_serialized_2")
+    {
+        CCoinsStats stats;
+        FlushStateToDisk();
+        if (GetUTXOStats(pcoinsdbview, stats))
+        {
+            ret.pushKV("height", (int64_t)stats.nHeight);
+            ret.pushKV("bestblock", stats.hashBlock.GetHex());
+            ret.pushKV("transactions", (int64_t)stats.nTransactions);
+            ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
+            ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
+            ret.pushKV("disk_size", stats.nDiskSize);
+            ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+        }
+        return ret;
+    }
+    if (strType != "muhash" && strType != "verify")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown hash_type " + strType);
+
+    // Without -utxostats the muhash statistics can only come from a scan.
+    CUTXOStats stats;
+    std::unique_ptr<CUTXOStats> running;
+    if (strType == "muhash")
     {
-        ret.pushKV("height", (int64_t)stats.nHeight);
-        ret.pushKV("bestblock", stats.hashBlock.GetHex());
-        ret.pushKV("transactions", (int64_t)stats.nTransactions);
-        ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
-        ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
-        ret.pushKV("disk_size", stats.nDiskSize);
-        ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+        LOCK(cs_main);
+        if (g_utxostats)
+            running.reset(new CUTXOStats(*g_utxostats));
+    }
+    if (running)
+        stats = *running;
+    else if (!ScanUTXOStats(pcoinsdbview, stats, &running))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the UTXO set");
+
+    CBlockIndex *pindex = LookupBlockIndex(stats.hashBlock);
+    uint256 hashMuHash = stats.GetMuHash();
+    ret.pushKV("height", pindex ? (int64_t)pindex->nHeight : -1);
+    ret.pushKV("bestblock", stats.hashBlock.GetHex());
+    ret.pushKV("txouts", stats.nTransactionOutputs);
+    ret.pushKV("muhash", hashMuHash.GetHex());
+    ret.pushKV("disk_size", (uint64_t)pcoinsdbview->EstimateSize());
+    ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+    if (strType == "verify")
+    {
+        ret.pushKV("verified", running && running->hashBlock == stats.hashBlock &&
+                                   running->nTransactionOutputs == stats.nTransactionOutputs &&
+                                   running->nTotalAmount == stats.nTotalAmount && running->GetMuHash() == hashMuHash);
     }
     return ret;
 }
 
+UniValue dumptxoutset(const UniValue &params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrite the unspent transaction output set and the headers leading to it to a snapshot file that a new\n"
+            "node can be started from with -loadutxosnapshot.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"       (string, required) The file to write, relative to the data directory if not absolute\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"path\": \"path\",              (string) The absolute path of the snapshot\n"
+            "  \"height\":n,                  (numeric) The height of the snapshot block\n"
+            "  \"bestblock\": \"hex\",         (string) The hash of the snapshot block\n"
+            "  \"coins_written\": n,          (numeric) The number of unspent outputs written\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The hash of the outputs, as gettxoutsetinfo reports it\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("dumptxoutset", "\"utxo.dat\"") + HelpExampleRpc("dumptxoutset", "\"utxo.dat\""));
+
+    fs::path path = fs::absolute(params[0].get_str(), GetDataDir());
+    if (fs::exists(path))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+
+    CUTXOSnapshotHeader header = DumpUTXOSnapshot(pcoinsdbview, path);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("path", path.string());
+    ret.pushKV("height", (int64_t)header.nHeight);
+    ret.pushKV("bestblock", header.hashBlock.GetHex());
+    ret.pushKV("coins_written", (int64_t)header.nCoins);
+    ret.pushKV("hash_serialized_2", header.hashSerialized.GetHex());
+    return ret;
+}
+
 UniValue evicttransaction(const UniValue &params, bool fHelp)
 {
     if (fHelp || params.size() < 1)
@@ -1327,6 +1376,23 @@ UniValue getchaintips(const UniValue &params, bool fHelp)
     return res;
 }
 
+static UniValue GetTxAdmissionInfo()
+{
+    UniValue threads(UniValue::VARR);
+    for (const CTxAdmissionShardStats &stats : GetTxAdmissionShardStats())
+    {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("thread", (int)stats.nThread);
+        obj.pushKV("queued", stats.nQueued);
+        obj.pushKV("enqueued", stats.nEnqueued);
+        obj.pushKV("deferred", stats.nDeferred);
+        obj.pushKV("processed", stats.nProcessed);
+        obj.pushKV("accepted", stats.nAccepted);
+        threads.push_back(obj);
+    }
+    return threads;
+}
+
 UniValue mempoolInfoToJSON()
 {
     UniValue ret(UniValue::VOBJ);
@@ -1355,6 +1421,7 @@ UniValue mempoolInfoToJSON()
     {
         ret.pushKV("peak_tps", "N/A");
     }
+    ret.pushKV("txadmission", GetTxAdmissionInfo());
 
     return ret;
 }
@@ -1373,6 +1440,18 @@ UniValue getmempoolinfo(const UniValue &params, bool fHelp)
                             "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee for tx to be accepted\n"
                             "  \"tps\": xxxxx                 (numeric) Transactions per second accepted\n"
                             "  \"peak_tps\": xxxxx            (numeric) Peak Transactions per second accepted\n"
+                            "  \"txadmission\": [              (array) information per transaction admission thread\n"
+                            "    {\n"
+                            "      \"thread\": n,               (numeric) admission thread index\n"
+                            "      \"queued\": n,               (numeric) transactions waiting on its input queue\n"
+                            "      \"enqueued\": n,             (numeric) transactions routed to its input queue\n"
+                            "      \"deferred\": n,             (numeric) transactions routed to it that were deferred "
+                            "as possible double spends\n"
+                            "      \"processed\": n,            (numeric) transactions it validated\n"
+                            "      \"accepted\": n,             (numeric) transactions it accepted\n"
+                            "    }\n"
+                            "  ,...\n"
+                            "  ]\n"
                             "}\n"
                             "\nExamples:\n" +
                             HelpExampleCli("getmempoolinfo", "") + HelpExampleRpc("getmempoolinfo", ""));
@@ -1990,6 +2069,7 @@ static const CRPCCommand commands[] = {
     {"blockchain", "evicttransaction", &evicttransaction, true}, {"blockchain", "getrawmempool", &getrawmempool, true},
     {"blockchain", "getraworphanpool", &getraworphanpool, true}, {"blockchain", "gettxout", &gettxout, true},
     {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true}, {"blockchain", "savemempool", &savemempool, true},
+    {"blockchain", "dumptxoutset", &dumptxoutset, true},
     {"blockchain", "verifychain", &verifychain, true}, {"blockchain", "getblockstats", &getblockstats, true},
 
     /* Not shown in help */
@@ -14,6 +14,7 @@
 #include "net.h"
 #include "netbase.h"
 #include "protocol.h"
+#include "socketevents.h"
 #include "sync.h"
 #include "timedata.h"
 #include "tweak.h"
@@ -458,6 +459,22 @@ static UniValue GetNetworksInfo()
     return networks;
 }
 
+static UniValue GetSocketHandlersInfo()
+{
+    UniValue handlers(UniValue::VARR);
+    for (const CSocketHandlerStats &stats : GetSocketHandlerStats())
+    {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("thread", (int)stats.nThread);
+        obj.pushKV("peers", (int)stats.nPeers);
+        obj.pushKV("bytesrecv", stats.nBytesRecv);
+        obj.pushKV("bytessent", stats.nBytesSent);
+        obj.pushKV("loops", stats.nLoops);
+        handlers.push_back(obj);
+    }
+    return handlers;
+}
+
 static UniValue GetThinBlockStats()
 {
     UniValue obj(UniValue::VOBJ);
@@ -536,6 +553,18 @@ UniValue getnetworkinfo(const UniValue &params, bool fHelp)
             "  \"localservices\": \"xxxxxxxxxxxxxxxx\", (string) the services we offer to the network\n"
             "  \"timeoffset\": xxxxx,                 (numeric) the time offset\n"
             "  \"connections\": xxxxx,                (numeric) the number of connections\n"
+            "  \"socketbackend\": \"xxx\",              (string) the mechanism used to wait for socket activity\n"
+            "  \"sockethandlers\": [                  (array) information per socket handler thread\n"
+            "    {\n"
+            "      \"thread\": n,                     (numeric) socket handler thread index\n"
+            "      \"peers\": n,                      (numeric) number of peers serviced by this thread\n"
+            "      \"bytesrecv\": n,                  (numeric) bytes received by this thread\n"
+            "      \"bytessent\": n,                  (numeric) bytes sent by this thread (excluding optimistic "
+            "sends made by the message handlers)\n"
+            "      \"loops\": n,                      (numeric) number of event loop iterations\n"
+            "    }\n"
+            "  ,...\n"
+            "  ],\n"
             "  \"networks\": [                        (array) information per network\n"
             "    {\n"
             "      \"name\": \"xxx\",                   (string) network (ipv4, ipv6 or onion)\n"
@@ -580,6 +609,8 @@ UniValue getnetworkinfo(const UniValue &params, bool fHelp)
     obj.pushKV("localservices", strprintf("%016x", nLocalServices));
     obj.pushKV("timeoffset", GetTimeOffset());
     obj.pushKV("connections", (int)vNodes.size());
+    obj.pushKV("socketbackend", SocketBackendName(socketBackend));
+    obj.pushKV("sockethandlers", GetSocketHandlersInfo());
     obj.pushKV("networks", GetNetworksInfo());
     obj.pushKV("relayfee", ValueFromAmount(::minRelayTxFee.GetFeePerK()));
     obj.pushKV("minlimitertxfee", strprintf("%.4f", dMinLimiterTxFee.Value()));
@@ -191,6 +191,15 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<uint8
     const CPubKey &pubkey,
     const uint256 &sighash) const
 {
+    // Under NULLFAIL an invalid non-empty signature fails the script whichever opcode checked it, and legacy
+    // multisig never gets to check a Schnorr signature.  So the script can carry on as if the signature was good,
+    // and the batch decides whether it really was.
+    if (schnorrBatch && vchSig.size() == 64 && (nFlags & SCRIPT_VERIFY_NULLFAIL) && pubkey.IsValid())
+    {
+        if (!IsCached(vchSig, pubkey, sighash))
+            schnorrBatch->Add(pubkey, sighash, vchSig);
+        return true;
+    }
     return RunMemoizedCheck(vchSig, pubkey, sighash, nFlags, store,
         [&] { return TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash); });
 }
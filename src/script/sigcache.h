@@ -17,19 +17,23 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 
 class CPubKey;
+class CSchnorrBatch;
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
+    //! if set, Schnorr signatures that are not cached are added to this batch instead of being verified
+    CSchnorrBatch *schnorrBatch;
 
 public:
     CachingTransactionSignatureChecker(const CTransaction *txToIn,
         unsigned int nInIn,
         const CAmount &amountIn,
         unsigned int flags,
-        bool storeIn = true)
-        : TransactionSignatureChecker(txToIn, nInIn, amountIn, flags), store(storeIn)
+        bool storeIn = true,
+        CSchnorrBatch *schnorrBatchIn = nullptr)
+        : TransactionSignatureChecker(txToIn, nInIn, amountIn, flags), store(storeIn), schnorrBatch(schnorrBatchIn)
     {
     }
 
@@ -27,6 +27,138 @@ int secp256k1_schnorr_verify(
     return secp256k1_schnorr_sig_verify(&ctx->ecmult_ctx, sig64, &q, msg32);
 }
 
+typedef struct {
+    const secp256k1_context *ctx;
+    const unsigned char *const *sig64;
+    const unsigned char *const *msg32;
+    const secp256k1_pubkey *const *pubkeys;
+    unsigned char seed[32];
+} secp256k1_schnorr_batch_data;
+
+/**
+ * The i'th signature's equation is multiplied by a_i so that invalid
+ * signatures cannot cancel each other out. a_0 is 1, the others are derived
+ * from a hash of the whole batch so that the signers cannot choose them.
+ */
+static void secp256k1_schnorr_batch_randomizer(secp256k1_scalar *a, const unsigned char *seed, size_t i) {
+    secp256k1_sha256 sha;
+    unsigned char buf[32];
+    unsigned char idx[8];
+    int overflow;
+    int j;
+
+    if (i == 0) {
+        secp256k1_scalar_set_int(a, 1);
+        return;
+    }
+    for (j = 0; j < 8; j++) {
+        idx[j] = (i >> (8 * j)) & 0xff;
+    }
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, seed, 32);
+    secp256k1_sha256_write(&sha, idx, 8);
+    secp256k1_sha256_finalize(&sha, buf);
+    secp256k1_scalar_set_b32(a, buf, &overflow);
+}
+
+/** Supplies a_i * R_i for even idx and a_i * e_i * P_i for odd idx. */
+static int secp256k1_schnorr_batch_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *cbdata) {
+    secp256k1_schnorr_batch_data *data = (secp256k1_schnorr_batch_data *)cbdata;
+    size_t i = idx / 2;
+    secp256k1_scalar a, e;
+    secp256k1_fe rx;
+
+    secp256k1_schnorr_batch_randomizer(&a, data->seed, i);
+    if (idx % 2 == 0) {
+        /* Decompress R with a quadratic residue y, this fails if r >= p or is not on the curve. */
+        if (!secp256k1_fe_set_b32(&rx, data->sig64[i]) || !secp256k1_ge_set_xquad(pt, &rx)) {
+            return 0;
+        }
+        *sc = a;
+    } else {
+        if (!secp256k1_pubkey_load(data->ctx, pt, data->pubkeys[i])) {
+            return 0;
+        }
+        secp256k1_schnorr_compute_e(&e, data->sig64[i], pt, data->msg32[i]);
+        secp256k1_scalar_mul(sc, &a, &e);
+    }
+    return 1;
+}
+
+/**
+ * Uses option 2 of the verification described in schnorr_impl.h: all the
+ * signatures are valid if sum(a_i * R_i) + sum(a_i * e_i * P_i)
+ * - sum(a_i * s_i) * G is infinity, computed as one multi-multiplication.
+ */
+static int secp256k1_schnorr_sig_verify_batch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch *scratch,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_pubkey *const *pubkeys,
+    size_t n_sigs
+) {
+    secp256k1_schnorr_batch_data data;
+    secp256k1_sha256 sha;
+    secp256k1_scalar sum, s, a;
+    secp256k1_gej rj;
+    size_t i;
+    int overflow;
+
+    if (n_sigs == 0) {
+        return 1;
+    }
+
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n_sigs; i++) {
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        secp256k1_sha256_write(&sha, pubkeys[i]->data, sizeof(pubkeys[i]->data));
+    }
+    secp256k1_sha256_finalize(&sha, data.seed);
+    data.ctx = ctx;
+    data.sig64 = sig64;
+    data.msg32 = msg32;
+    data.pubkeys = pubkeys;
+
+    secp256k1_scalar_set_int(&sum, 0);
+    for (i = 0; i < n_sigs; i++) {
+        overflow = 0;
+        secp256k1_scalar_set_b32(&s, sig64[i] + 32, &overflow);
+        if (overflow) {
+            return 0;
+        }
+        secp256k1_schnorr_batch_randomizer(&a, data.seed, i);
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&sum, &sum, &s);
+    }
+    secp256k1_scalar_negate(&sum, &sum);
+
+    if (!secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &rj, &sum, secp256k1_schnorr_batch_callback, &data,
+            2 * n_sigs)) {
+        return 0;
+    }
+    return secp256k1_gej_is_infinity(&rj);
+}
+
+int secp256k1_schnorr_verify_batch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space *scratch,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_pubkey *const *pubkeys,
+    size_t n_sigs
+) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(scratch != NULL);
+    ARG_CHECK(n_sigs == 0 || sig64 != NULL);
+    ARG_CHECK(n_sigs == 0 || msg32 != NULL);
+    ARG_CHECK(n_sigs == 0 || pubkeys != NULL);
+
+    return secp256k1_schnorr_sig_verify_batch(ctx, scratch, sig64, msg32, pubkeys, n_sigs);
+}
+
 int secp256k1_schnorr_sign(
     const secp256k1_context *ctx,
     unsigned char *sig64,
@@ -77,6 +77,65 @@ void test_schnorr_sign_verify(void) {
 
 #undef SIG_COUNT
 
+#define BATCH_COUNT 40
+
+void test_schnorr_verify_batch(void) {
+    unsigned char privkey[32];
+    unsigned char msg[BATCH_COUNT][32];
+    unsigned char sig[BATCH_COUNT][64];
+    secp256k1_pubkey pubkey[BATCH_COUNT];
+    const unsigned char *sigptr[BATCH_COUNT];
+    const unsigned char *msgptr[BATCH_COUNT];
+    const secp256k1_pubkey *pubkeyptr[BATCH_COUNT];
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 1024 * 1024);
+    int i, pos, mod;
+
+    for (i = 0; i < BATCH_COUNT; i++) {
+        secp256k1_scalar key;
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msg[i]);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkey[i], privkey) == 1);
+        CHECK(secp256k1_schnorr_sign(ctx, sig[i], msg[i], privkey, NULL, NULL) == 1);
+        sigptr[i] = sig[i];
+        msgptr[i] = msg[i];
+        pubkeyptr[i] = &pubkey[i];
+    }
+
+    /* An empty batch and batches of valid signatures verify. */
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, NULL, NULL, NULL, 0) == 1);
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, 1) == 1);
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 1);
+
+    /* A single bad signature anywhere in the batch makes it fail. */
+    i = secp256k1_rand_int(BATCH_COUNT);
+    pos = secp256k1_rand_bits(6);
+    mod = 1 + secp256k1_rand_int(255);
+    sig[i][pos] ^= mod;
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 0);
+    sig[i][pos] ^= mod;
+
+    /* So does a signature checked against the wrong message or key. */
+    msgptr[0] = msg[1];
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 0);
+    msgptr[0] = msg[0];
+    pubkeyptr[BATCH_COUNT - 1] = &pubkey[0];
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 0);
+    pubkeyptr[BATCH_COUNT - 1] = &pubkey[BATCH_COUNT - 1];
+
+    /* Two bad signatures cannot cancel each other out. */
+    sigptr[0] = sig[1];
+    sigptr[1] = sig[0];
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 0);
+    sigptr[0] = sig[0];
+    sigptr[1] = sig[1];
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 1);
+
+    secp256k1_scratch_space_destroy(scratch);
+}
+
+#undef BATCH_COUNT
+
 void run_schnorr_compact_test(void) {
     {
         /* Test vector 1 */
@@ -515,6 +574,7 @@ void run_schnorr_tests(void) {
     }
 
     test_schnorr_sign_verify();
+    test_schnorr_verify_batch();
     run_schnorr_compact_test();
 }
 
@@ -0,0 +1,216 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "net.h"
+#include "util.h"
+
+#ifdef USE_EPOLL
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#ifdef USE_EPOLL
+SocketBackend socketBackend = SocketBackend::EPOLL;
+#else
+SocketBackend socketBackend = SocketBackend::SELECT;
+#endif
+
+bool ParseSocketBackend(const std::string &name, SocketBackend &backend)
+{
+    if (name == "select")
+    {
+        backend = SocketBackend::SELECT;
+        return true;
+    }
+#ifdef USE_EPOLL
+    if (name == "epoll")
+    {
+        backend = SocketBackend::EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string SocketBackendName(SocketBackend backend)
+{
+    switch (backend)
+    {
+    case SocketBackend::SELECT:
+        return "select";
+    case SocketBackend::EPOLL:
+        return "epoll";
+    }
+    return "unknown";
+}
+
+bool IsServiceableSocket(SOCKET s)
+{
+    if (socketBackend == SocketBackend::EPOLL)
+        return true;
+    return IsSelectableSocket(s);
+}
+
+#ifdef USE_EPOLL
+// Peer sockets store the CNode pointer in epoll_data.u64.  CNode objects are at least 2 byte aligned so the low bit
+// is free to tag listen sockets (whose index is stored in the upper bits).  The wakeup eventfd is stored as 0.
+static const uint64_t EPOLL_LISTEN_TAG = 1;
+static const uint64_t EPOLL_WAKEUP_TAG = 0;
+static const int EPOLL_MAX_EVENTS = 256;
+
+CEpollSocketEvents::CEpollSocketEvents() : epollfd(-1), wakefd(-1) { vEpollEvents.resize(EPOLL_MAX_EVENTS); }
+CEpollSocketEvents::~CEpollSocketEvents()
+{
+    {
+        LOCK(cs_wakeup);
+        for (CNode *pnode : vWakeup)
+        {
+            pnode->fSocketWakeup = false;
+            pnode->Release();
+        }
+        vWakeup.clear();
+    }
+    if (wakefd >= 0)
+        close(wakefd);
+    if (epollfd >= 0)
+        close(epollfd);
+}
+
+bool CEpollSocketEvents::Init()
+{
+    epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollfd < 0)
+    {
+        LOGA("epoll_create1 failed: %s\n", NetworkErrorString(errno));
+        return false;
+    }
+    wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakefd < 0)
+    {
+        LOGA("eventfd failed: %s\n", NetworkErrorString(errno));
+        return false;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = EPOLL_WAKEUP_TAG;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, wakefd, &ev) != 0)
+    {
+        LOGA("epoll_ctl failed to add the wakeup event: %s\n", NetworkErrorString(errno));
+        return false;
+    }
+    return true;
+}
+
+bool CEpollSocketEvents::AddListenSocket(SOCKET hSocket, size_t nListenIdx)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = (((uint64_t)nListenIdx) << 1) | EPOLL_LISTEN_TAG;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &ev) != 0)
+    {
+        LOGA("epoll_ctl failed to add listen socket: %s\n", NetworkErrorString(errno));
+        return false;
+    }
+    return true;
+}
+
+bool CEpollSocketEvents::AddNode(CNode *pnode)
+{
+    static_assert(alignof(CNode) >= 2, "the low bit of a CNode pointer is used as a tag");
+    SOCKET hSocket = pnode->hSocket;
+    if (hSocket == INVALID_SOCKET)
+        return false;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.u64 = (uint64_t)pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &ev) != 0)
+    {
+        LOG(NET, "epoll_ctl failed to add socket for peer %s: %s\n", pnode->GetLogName(), NetworkErrorString(errno));
+        return false;
+    }
+    return true;
+}
+
+void CEpollSocketEvents::RemoveSocket(SOCKET hSocket)
+{
+    // Closing a socket normally removes it from the epoll set, but not if the descriptor was duplicated (for example
+    // across a fork() for -blocknotify), so remove it explicitly to be sure no events arrive for a deleted CNode.
+    struct epoll_event ev;
+    epoll_ctl(epollfd, EPOLL_CTL_DEL, hSocket, &ev);
+}
+
+void CEpollSocketEvents::Wakeup(CNode *pnode)
+{
+    // Only queue a node once until the socket handler has picked it up
+    if (pnode->fSocketWakeup.exchange(true))
+        return;
+    {
+        LOCK(cs_wakeup);
+        vWakeup.push_back(pnode->AddRef());
+    }
+    uint64_t one = 1;
+    if (write(wakefd, &one, sizeof(one)) < 0)
+    {
+        // EAGAIN means the counter is already saturated so the socket handler will be woken anyway
+    }
+}
+
+void CEpollSocketEvents::TakeWakeups(std::vector<CNode *> &vNodesOut)
+{
+    LOCK(cs_wakeup);
+    for (CNode *pnode : vWakeup)
+    {
+        pnode->fSocketWakeup = false;
+        vNodesOut.push_back(pnode);
+    }
+    vWakeup.clear();
+}
+
+bool CEpollSocketEvents::Wait(std::vector<Event> &vEventsOut, int nTimeoutMs)
+{
+    vEventsOut.clear();
+    int nEvents = epoll_wait(epollfd, vEpollEvents.data(), vEpollEvents.size(), nTimeoutMs);
+    if (nEvents < 0)
+    {
+        if (errno == EINTR)
+            return true;
+        LOG(NET, "epoll_wait error %s\n", NetworkErrorString(errno));
+        return false;
+    }
+
+    for (int i = 0; i < nEvents; i++)
+    {
+        const struct epoll_event &ev = vEpollEvents[i];
+        if (ev.data.u64 == EPOLL_WAKEUP_TAG)
+        {
+            // Reset the counter, the woken nodes themselves are collected by TakeWakeups()
+            uint64_t count;
+            if (read(wakefd, &count, sizeof(count)) < 0)
+            {
+                // EAGAIN means another event already drained the counter
+            }
+            continue;
+        }
+
+        Event out;
+        if (ev.data.u64 & EPOLL_LISTEN_TAG)
+        {
+            out.pnode = nullptr;
+            out.nListenIdx = ev.data.u64 >> 1;
+        }
+        else
+        {
+            out.pnode = (CNode *)ev.data.u64;
+            out.nListenIdx = 0;
+        }
+        out.fRecv = (ev.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) != 0;
+        out.fSend = (ev.events & EPOLLOUT) != 0;
+        out.fError = (ev.events & EPOLLERR) != 0;
+        vEventsOut.push_back(out);
+    }
+    return true;
+}
+#endif
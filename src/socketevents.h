@@ -0,0 +1,120 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#if defined(HAVE_CONFIG_H)
+#include "config/bitcoin-config.h"
+#endif
+
+#include "compat.h"
+#include "sync.h"
+
+#include <string>
+#include <vector>
+
+#if defined(HAVE_SYS_EPOLL_H) && !defined(WIN32)
+#define USE_EPOLL 1
+#include <sys/epoll.h>
+#endif
+
+class CNode;
+
+/** The OS facility the socket handler thread uses to find out which sockets are ready */
+enum class SocketBackend : uint8_t
+{
+    //! rebuild fd_sets and select() over every peer on each loop (limited to FD_SETSIZE descriptors)
+    SELECT,
+    //! edge triggered epoll, only ready sockets are returned (linux only)
+    EPOLL
+};
+
+#ifdef USE_EPOLL
+static const char *const DEFAULT_SOCKET_BACKEND = "epoll";
+#else
+static const char *const DEFAULT_SOCKET_BACKEND = "select";
+#endif
+
+/** The backend chosen at startup via -socketbackend */
+extern SocketBackend socketBackend;
+
+/** Convert a -socketbackend name into its enum.  Returns false if the name is unknown or the backend is not
+    available on this platform. */
+bool ParseSocketBackend(const std::string &name, SocketBackend &backend);
+/** Return the -socketbackend name of a backend */
+std::string SocketBackendName(SocketBackend backend);
+/** Return true if a socket can be serviced by the configured backend (select() cannot handle fd >= FD_SETSIZE) */
+bool IsServiceableSocket(SOCKET s);
+
+#ifdef USE_EPOLL
+/** A thin wrapper around an epoll instance used by the socket handler thread.
+
+    Peer sockets are registered edge triggered for both read and write readiness, so each readiness transition is
+    reported exactly once and the socket handler must remember it (see CNode::fSocketRecvReady/fSocketSendReady)
+    until a recv() or send() returns EWOULDBLOCK.  Listen sockets are registered level triggered so that pending
+    connections are reported until accepted.
+
+    Each socket handler thread owns one instance.  Peer sockets are registered by whatever thread creates the
+    connection, but events are only consumed by the owning socket handler thread.  The registered CNode pointer
+    stays valid for as long as events can be returned for it because closing the socket removes it from the epoll
+    set, and the owning thread holds a reference on the node until it notices the socket was closed.
+ */
+class CEpollSocketEvents
+{
+public:
+    /** A readiness notification returned by Wait() */
+    struct Event
+    {
+        //! the node whose socket is ready, or nullptr if this is a listen socket
+        CNode *pnode;
+        //! index of the ready listen socket as passed to AddListenSocket(), if pnode is nullptr
+        size_t nListenIdx;
+        bool fRecv;
+        bool fSend;
+        bool fError;
+    };
+
+protected:
+    int epollfd;
+    //! eventfd used to interrupt epoll_wait() when a node has new data to send
+    int wakefd;
+
+    CCriticalSection cs_wakeup;
+    //! nodes that queued data to send that the socket handler has not seen yet.  Each holds a reference.
+    std::vector<CNode *> vWakeup GUARDED_BY(cs_wakeup);
+
+    std::vector<struct epoll_event> vEpollEvents;
+
+public:
+    CEpollSocketEvents();
+    ~CEpollSocketEvents();
+
+    /** Create the epoll instance. Returns false (and logs) if the kernel refused. */
+    bool Init();
+
+    /** Register a listening socket.  nListenIdx is returned in the Event when a connection is pending. */
+    bool AddListenSocket(SOCKET hSocket, size_t nListenIdx);
+
+    /** Register a connected peer socket.  May be called from any thread. */
+    bool AddNode(CNode *pnode);
+
+    /** Unregister a peer socket before it is closed.  May be called from any thread. */
+    void RemoveSocket(SOCKET hSocket);
+
+    /** Tell the socket handler that pnode has queued data that could not be sent optimistically.
+        May be called from any thread. */
+    void Wakeup(CNode *pnode);
+
+    /** Move all nodes passed to Wakeup() since the last call into vNodesOut.  The caller takes over the reference
+        held on each node. */
+    void TakeWakeups(std::vector<CNode *> &vNodesOut);
+
+    /** Wait up to nTimeoutMs milliseconds for socket readiness and return what became ready in vEventsOut.
+        Returns false on an epoll error. */
+    bool Wait(std::vector<Event> &vEventsOut, int nTimeoutMs);
+};
+#endif
+
+#endif // BITCOIN_SOCKETEVENTS_H
@@ -297,6 +297,13 @@ public:
         clear();
     }
 
+    /** Exchange the whole underlying buffer (including any bytes already read) with data and rewind to its start */
+    void swap(CSerializeData &data)
+    {
+        vch.swap(data);
+        nReadPos = 0;
+    }
+
     /**
      * XOR the contents of this stream with a certain key.
      *
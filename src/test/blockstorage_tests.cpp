@@ -0,0 +1,49 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockstorage/blockstorage.h"
+#include "chainparams.h"
+#include "main.h"
+#include "streams.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockstorage_tests, TestChain100Setup)
+
+BOOST_AUTO_TEST_CASE(read_raw_block)
+{
+    const size_t nOffset = CMessageHeader::HEADER_SIZE;
+    std::vector<const CBlockIndex *> vIndex;
+    {
+        LOCK(cs_main);
+        vIndex.push_back(chainActive.Genesis());
+        vIndex.push_back(chainActive[50]);
+        vIndex.push_back(chainActive.Tip());
+    }
+
+    for (const CBlockIndex *pindex : vIndex)
+    {
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << block;
+
+        // the raw bytes are the block as it is serialized on the wire, after the room left for the caller
+        CSerializeData data(nOffset, 'x');
+        BOOST_CHECK(ReadRawBlockFromDisk(data, nOffset, pindex, Params().MessageStart()));
+        BOOST_CHECK_EQUAL(data.size(), nOffset + ss.size());
+        BOOST_CHECK(std::equal(ss.begin(), ss.end(), data.begin() + nOffset));
+    }
+
+    // data that does not belong to the index entry is rejected
+    CBlockIndex index(*vIndex[1]);
+    index.nDataPos = vIndex[2]->nDataPos;
+    index.nFile = vIndex[2]->nFile;
+    CSerializeData data;
+    BOOST_CHECK(!ReadRawBlockFromDisk(data, nOffset, &index, Params().MessageStart()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,14 +4,17 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "coins.h"
+#include "coinsflatmap.h"
 #include "consensus/validation.h"
 #include "main.h"
 #include "test/test_bitcoin.h"
 #include "test/test_random.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "undo.h"
 
 #include <map>
+#include <thread>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -114,6 +117,30 @@ public:
     CCoinsMap &map() const { return cacheCoins; }
     size_t &usage() const { return cachedCoinsUsage; }
 };
+
+class CCoinsViewShardedCacheTest : public CCoinsViewShardedCache
+{
+public:
+    CCoinsViewShardedCacheTest(CCoinsView *_base, unsigned int nShards) : CCoinsViewShardedCache(_base, nShards) {}
+    void SelfTest() const
+    {
+        // Manually recompute the dynamic usage of each shard, and compare the totals.
+        size_t ret = 0;
+        size_t count = 0;
+        for (auto &shard : vShards)
+        {
+            ret += memusage::DynamicUsage(shard->cacheCoins);
+            for (CCoinsMap::iterator it = shard->cacheCoins.begin(); it != shard->cacheCoins.end(); it++)
+            {
+                BOOST_CHECK(&GetShard(it->first) == shard.get());
+                ret += it->second.coin.DynamicMemoryUsage();
+                ++count;
+            }
+        }
+        BOOST_CHECK_EQUAL(GetCacheSize(), count);
+        BOOST_CHECK_EQUAL(DynamicMemoryUsage(), ret);
+    }
+};
 }
 
 BOOST_FIXTURE_TEST_SUITE(coins_tests, BasicTestingSetup)
@@ -776,5 +803,265 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(coins_sharded_cache)
+{
+    // A simple map to track what we expect the cache to represent.
+    std::map<COutPoint, Coin> result;
+    CCoinsViewTest base;
+    CCoinsViewShardedCacheTest cache(&base, 4);
+
+    std::vector<COutPoint> outpoints;
+    for (unsigned int i = 0; i < 500; i++)
+        outpoints.emplace_back(InsecureRand256(), i % 3);
+
+    for (unsigned int i = 0; i < NUM_SIMULATION_ITERATIONS; i++)
+    {
+        const COutPoint &out = outpoints[insecure_rand() % outpoints.size()];
+        Coin &coin = result[out];
+        BOOST_CHECK(cache.AccessCoin(out) == coin);
+        BOOST_CHECK_EQUAL(cache.HaveCoin(out), !coin.IsSpent());
+
+        if (insecure_rand() % 5 == 0 || coin.IsSpent())
+        {
+            Coin newcoin;
+            newcoin.out.nValue = insecure_rand();
+            newcoin.nHeight = 1 + insecure_rand() % 100;
+            newcoin.out.scriptPubKey.assign(insecure_rand() & 0x3F, 0);
+            bool fOverwrite = !coin.IsSpent();
+            coin = newcoin;
+            cache.AddCoin(out, std::move(newcoin), fOverwrite);
+        }
+        else
+        {
+            Coin spent;
+            cache.SpendCoin(out, &spent);
+            BOOST_CHECK(spent == coin);
+            coin.Clear();
+        }
+
+        if (insecure_rand() % 20 == 0)
+            cache.Uncache(outpoints[insecure_rand() % outpoints.size()]);
+        if (insecure_rand() % 1000 == 0)
+        {
+            BOOST_CHECK(cache.Flush());
+            cache.Trim(insecure_rand() % (cache.DynamicMemoryUsage() + 1));
+        }
+        if (insecure_rand() % 100 == 0)
+            cache.SelfTest();
+    }
+
+    // Once flushed, the base holds the same coins, and a cache on top of it sees them as well.
+    BOOST_CHECK(cache.Flush());
+    cache.SelfTest();
+    CCoinsViewCacheTest check(&base);
+    for (const auto &item : result)
+    {
+        BOOST_CHECK(cache.AccessCoin(item.first) == item.second);
+        WRITELOCK(check.cs_utxo);
+        BOOST_CHECK(check._AccessCoin(item.first) == item.second);
+    }
+
+    // A child cache can be written into the sharded one.
+    CCoinsViewCacheTest child(&cache);
+    for (const auto &item : result)
+    {
+        if (!item.second.IsSpent())
+            child.SpendCoin(item.first);
+    }
+    BOOST_CHECK(child.Flush());
+    cache.SelfTest();
+    for (const auto &item : result)
+        BOOST_CHECK(!cache.HaveCoin(item.first));
+}
+
+BOOST_AUTO_TEST_CASE(coins_sharded_cache_concurrent)
+{
+    CCoinsViewTest base;
+    CCoinsViewShardedCacheTest cache(&base, CCoinsViewShardedCache::DEFAULT_SHARDS);
+    const unsigned int nThreads = 4;
+    const unsigned int nCoins = 1000;
+
+    // Each thread adds and then spends half of its own coins while the others do the same.
+    std::vector<uint256> txids;
+    for (unsigned int i = 0; i < nThreads; i++)
+        txids.push_back(InsecureRand256());
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < nThreads; i++)
+    {
+        threads.emplace_back([&cache, &txids, i]() {
+            for (unsigned int n = 0; n < nCoins; n++)
+            {
+                Coin coin;
+                coin.out.nValue = n + 1;
+                coin.nHeight = n + 1;
+                coin.out.scriptPubKey.assign(n % 0x3F, 0);
+                cache.AddCoin(COutPoint(txids[i], n), std::move(coin), false);
+            }
+            for (unsigned int n = 0; n < nCoins; n += 2)
+                cache.SpendCoin(COutPoint(txids[i], n));
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), nThreads * nCoins / 2);
+    for (unsigned int i = 0; i < nThreads; i++)
+    {
+        for (unsigned int n = 0; n < nCoins; n++)
+        {
+            Coin coin = cache.AccessCoin(COutPoint(txids[i], n));
+            BOOST_CHECK_EQUAL(coin.IsSpent(), n % 2 == 0);
+            if (!coin.IsSpent())
+                BOOST_CHECK_EQUAL(coin.out.nValue, n + 1);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(coins_flat_map)
+{
+    // Drive the flat map and a std::map with the same random operations and check that they agree.
+    std::map<COutPoint, CAmount> result;
+    CCoinsFlatMap flat;
+
+    std::vector<COutPoint> outpoints;
+    for (unsigned int i = 0; i < 2000; i++)
+        outpoints.emplace_back(InsecureRand256(), i % 3);
+
+    for (unsigned int i = 0; i < NUM_SIMULATION_ITERATIONS; i++)
+    {
+        const COutPoint &out = outpoints[insecure_rand() % outpoints.size()];
+        CCoinsFlatMap::iterator it = flat.find(out);
+        BOOST_CHECK_EQUAL(it != flat.end(), result.count(out) != 0);
+        if (it != flat.end())
+            BOOST_CHECK_EQUAL(it->second.coin.out.nValue, result[out]);
+
+        if (insecure_rand() % 3 == 0)
+        {
+            BOOST_CHECK_EQUAL(flat.erase(out), result.erase(out));
+        }
+        else
+        {
+            CAmount nValue = insecure_rand();
+            CCoinsCacheEntry &entry = flat[out];
+            entry.coin.out.nValue = nValue;
+            entry.flags = CCoinsCacheEntry::DIRTY;
+            result[out] = nValue;
+        }
+        BOOST_CHECK_EQUAL(flat.size(), result.size());
+
+        if (insecure_rand() % 5000 == 0)
+        {
+            // Erase every other entry while iterating; the entry moved into an erased position is still visited.
+            size_t nBefore = flat.size();
+            size_t nVisited = 0;
+            bool fErase = false;
+            for (CCoinsFlatMap::iterator it = flat.begin(); it != flat.end(); nVisited++)
+            {
+                BOOST_CHECK_EQUAL(it->second.coin.out.nValue, result[it->first]);
+                if ((fErase = !fErase))
+                {
+                    result.erase(it->first);
+                    it = flat.erase(it);
+                }
+                else
+                    ++it;
+            }
+            BOOST_CHECK_EQUAL(nVisited, nBefore);
+            BOOST_CHECK_EQUAL(flat.size(), result.size());
+        }
+    }
+
+    for (const auto &item : result)
+    {
+        CCoinsFlatMap::const_iterator it = flat.find(item.first);
+        BOOST_CHECK(it != flat.end() && it->second.coin.out.nValue == item.second);
+    }
+    size_t nCount = 0;
+    for (const auto &item : flat)
+    {
+        BOOST_CHECK(result.count(item.first));
+        nCount++;
+    }
+    BOOST_CHECK_EQUAL(nCount, result.size());
+
+    // The memory usage is exactly that of the arena and the table, and reserving up front avoids any regrowth.
+    BOOST_CHECK(flat.DynamicMemoryUsage() >= memusage::MallocUsage(flat.size() * sizeof(CCoinsFlatMap::value_type)));
+    flat.clear();
+    BOOST_CHECK(flat.empty());
+    flat.reserve(1000);
+    size_t nUsage = flat.DynamicMemoryUsage();
+    for (unsigned int i = 0; i < 1000; i++)
+        flat[outpoints[i]].flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+    BOOST_CHECK_EQUAL(flat.size(), 1000);
+    BOOST_CHECK_EQUAL(flat.DynamicMemoryUsage(), nUsage);
+}
+
+BOOST_AUTO_TEST_CASE(coins_db_background_flush)
+{
+    for (bool fBackground : {true, false})
+    {
+        SetBoolArg("-dbbackgroundflush", fBackground);
+        CCoinsViewDB db(1 << 20, true, true);
+        std::map<COutPoint, Coin> result;
+
+        // Flush a few generations of coins.  Whether or not the writer thread has caught up, the database view
+        // must agree with what was flushed into it.
+        for (int n = 0; n < 4; n++)
+        {
+            CCoinsViewCacheTest cache(&db);
+            for (unsigned int i = 0; i < 1000; i++)
+            {
+                COutPoint out(InsecureRand256(), i);
+                Coin coin;
+                coin.out.nValue = 1 + insecure_rand() % 1000;
+                coin.nHeight = n + 1;
+                coin.out.scriptPubKey.assign(insecure_rand() & 0x3F, 0);
+                result[out] = coin;
+                cache.AddCoin(out, std::move(coin), false);
+            }
+            for (auto &item : result)
+            {
+                if (!item.second.IsSpent() && insecure_rand() % 4 == 0)
+                {
+                    cache.SpendCoin(item.first);
+                    item.second.Clear();
+                }
+            }
+            uint256 hashBlock = InsecureRand256();
+            cache.SetBestBlock(hashBlock);
+            BOOST_CHECK(cache.Flush());
+
+            BOOST_CHECK(db.GetBestBlock() == hashBlock);
+            for (const auto &item : result)
+            {
+                Coin coin;
+                BOOST_CHECK_EQUAL(db.HaveCoin(item.first), !item.second.IsSpent());
+                BOOST_CHECK_EQUAL(db.GetCoin(item.first, coin), !item.second.IsSpent());
+                if (!item.second.IsSpent())
+                    BOOST_CHECK(coin == item.second);
+            }
+            BOOST_CHECK(db.WaitForFlush());
+            BOOST_CHECK(db.GetBestBlock() == hashBlock);
+        }
+
+        // Once the writer is done, the database itself holds every unspent coin.
+        std::unique_ptr<CCoinsViewCursor> cursor(db.Cursor());
+        size_t nCount = 0;
+        for (; cursor->Valid(); cursor->Next())
+        {
+            COutPoint key;
+            Coin coin;
+            BOOST_CHECK(cursor->GetKey(key) && cursor->GetValue(coin));
+            BOOST_CHECK(result[key] == coin);
+            nCount++;
+        }
+        size_t nUnspent = 0;
+        for (const auto &item : result)
+            nUnspent += !item.second.IsSpent();
+        BOOST_CHECK_EQUAL(nCount, nUnspent);
+    }
+    UnsetArg("-dbbackgroundflush");
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,10 +6,12 @@
 #include "crypto/aes.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/muhash.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
+#include "hashwrapper.h"
 #include "test/test_bitcoin.h"
 #include "test/test_random.h"
 #include "utilstrencodings.h"
@@ -456,4 +458,78 @@ BOOST_AUTO_TEST_CASE(aes_cbc_testvectors)
         "b2eb05e2c39be9fcda6c19078c6a9d1b3f461796d6b0d6b2e0c2a72b4d80e644");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    for (int i = 0; i <= 32; ++i)
+    {
+        unsigned char in[64 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 64 * i; ++j)
+        {
+            in[j] = insecure_rand() & 0xff;
+        }
+        for (int j = 0; j < i; ++j)
+        {
+            CHash256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+        }
+        SHA256D64(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+
+        // and in place, as the merkle root computation does it
+        SHA256D64(in, in, i);
+        BOOST_CHECK(memcmp(out1, in, 32 * i) == 0);
+    }
+}
+
+static uint256 MuHashFinalize(MuHash3072 muhash)
+{
+    uint256 hash;
+    muhash.Finalize(hash.begin());
+    return hash;
+}
+
+static MuHash3072 MuHashOf(const std::string &element)
+{
+    MuHash3072 muhash;
+    muhash.Insert((const unsigned char *)element.data(), element.size());
+    return muhash;
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    BOOST_CHECK_EQUAL(MuHashFinalize(MuHash3072()).GetHex(),
+        "dd5ad2a105c2d29495f577245c357409002329b9f4d6182c0af3dc2f462555c8");
+    BOOST_CHECK_EQUAL(
+        MuHashFinalize(MuHashOf("abc")).GetHex(), "8886c29eb80162869c17a8cf844c2c2a1a8e78a05fac5c1067eb2e46505586c4");
+
+    MuHash3072 muhash = MuHashOf("abc");
+    muhash *= MuHashOf("def");
+    muhash /= MuHashOf("ghi");
+    BOOST_CHECK_EQUAL(MuHashFinalize(muhash).GetHex(), "317d6086211897b2ec2a678674b87d4ea13866737c376f38e154b183b9eb5b02");
+
+    // The hash only depends on the set, not on the order of insertions and removals
+    std::vector<std::string> elements;
+    for (int i = 0; i < 16; i++)
+        elements.push_back(std::to_string(insecure_rand()));
+    MuHash3072 forward, backward, removed;
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        forward.Insert((const unsigned char *)elements[i].data(), elements[i].size());
+        const std::string &back = elements[elements.size() - 1 - i];
+        backward.Insert((const unsigned char *)back.data(), back.size());
+        removed.Remove((const unsigned char *)back.data(), back.size());
+    }
+    BOOST_CHECK(MuHashFinalize(forward) == MuHashFinalize(backward));
+    BOOST_CHECK(MuHashFinalize(forward) != MuHashFinalize(MuHash3072()));
+    forward *= removed;
+    BOOST_CHECK(MuHashFinalize(forward) == MuHashFinalize(MuHash3072()));
+
+    // The state survives a round trip through bytes, reduced or not
+    unsigned char state[MuHash3072::SERIALIZED_SIZE];
+    backward.GetBytes(state);
+    MuHash3072 restored;
+    restored.SetBytes(state);
+    BOOST_CHECK(MuHashFinalize(restored) == MuHashFinalize(backward));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
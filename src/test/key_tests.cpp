@@ -7,6 +7,7 @@
 
 #include "base58.h"
 #include "dstencode.h"
+#include "random.h"
 #include "script/script.h"
 #include "test/test_bitcoin.h"
 #include "uint256.h"
@@ -317,4 +318,46 @@ BOOST_AUTO_TEST_CASE(key_test1)
                                    "6b4b1573c84da49a38405d"));
 }
 
+BOOST_AUTO_TEST_CASE(schnorr_batch)
+{
+    CSchnorrBatch batch;
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK(batch.Verify());
+
+    std::vector<CKey> vKeys;
+    std::vector<uint256> vHashes;
+    std::vector<std::vector<uint8_t> > vSigs;
+    for (int i = 0; i < 10; i++)
+    {
+        vKeys.emplace_back();
+        vKeys.back().MakeNewKey(i % 2 == 0);
+        vHashes.push_back(GetRandHash());
+        vSigs.emplace_back();
+        BOOST_CHECK(vKeys.back().SignSchnorr(vHashes.back(), vSigs.back()));
+        batch.Add(vKeys.back().GetPubKey(), vHashes.back(), vSigs.back());
+    }
+    BOOST_CHECK_EQUAL(batch.size(), 10);
+    BOOST_CHECK(batch.Verify());
+    BOOST_CHECK_EQUAL(batch.FindInvalid(), -1);
+
+    // a signature for another message spoils the whole batch, and is found when checked one at a time
+    batch.Add(vKeys[3].GetPubKey(), vHashes[4], vSigs[3]);
+    batch.Add(vKeys[5].GetPubKey(), vHashes[5], vSigs[5]);
+    BOOST_CHECK(!batch.Verify());
+    BOOST_CHECK_EQUAL(batch.FindInvalid(), 10);
+
+    // so does a corrupted one
+    batch.clear();
+    BOOST_CHECK(batch.empty());
+    for (int i = 0; i < 10; i++)
+    {
+        std::vector<uint8_t> vchSig = vSigs[i];
+        if (i == 7)
+            vchSig[40] ^= 1;
+        batch.Add(vKeys[i].GetPubKey(), vHashes[i], vchSig);
+    }
+    BOOST_CHECK(!batch.Verify());
+    BOOST_CHECK_EQUAL(batch.FindInvalid(), 7);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "consensus/merkle.h"
+#include "parallel.h"
 #include "test/test_bitcoin.h"
 #include "test/test_random.h"
 
@@ -202,4 +203,42 @@ BOOST_AUTO_TEST_CASE(merkle_test)
     }
 }
 
+// Check that the merkle root of a block is the same whether or not its subtrees are hashed in parallel
+static void CheckParallelMerkleRoot(const CBlock &block)
+{
+    bool fMutated = false;
+    uint256 root = BlockMerkleRoot(block, &fMutated);
+    bool fParallelMutated = !fMutated;
+    BOOST_CHECK(PV->BlockMerkleRoot(block, &fParallelMutated) == root);
+    BOOST_CHECK_EQUAL(fParallelMutated, fMutated);
+}
+
+BOOST_AUTO_TEST_CASE(merkle_parallel)
+{
+    BOOST_REQUIRE(PV->ThreadCount() > 0);
+    const size_t nSubtreeLeaves = (size_t)1 << MERKLE_SUBTREE_LEVELS;
+    for (size_t nTx : {nSubtreeLeaves - 1, nSubtreeLeaves + 1, 3 * nSubtreeLeaves, 3 * nSubtreeLeaves + 7})
+    {
+        CBlock block;
+        for (size_t i = 0; i < nTx; i++)
+        {
+            CMutableTransaction tx;
+            tx.nLockTime = i;
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        CheckParallelMerkleRoot(block);
+
+        // a duplicated pair in the first subtree
+        CBlock blockDup = block;
+        blockDup.vtx[11] = blockDup.vtx[10];
+        CheckParallelMerkleRoot(blockDup);
+
+        // the last transactions repeated (CVE-2012-2459)
+        blockDup = block;
+        blockDup.vtx.push_back(block.vtx[nTx - 2]);
+        blockDup.vtx.push_back(block.vtx[nTx - 1]);
+        CheckParallelMerkleRoot(blockDup);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
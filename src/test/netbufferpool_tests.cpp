@@ -0,0 +1,114 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netbufferpool.h"
+#include "version.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(netbufferpool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(netbufferpool_recycle)
+{
+    netBufferPool.Clear();
+    uint64_t nHits = netBufferPool.hits();
+    uint64_t nMisses = netBufferPool.misses();
+
+    // small requests are rounded up to the smallest class
+    CSerializeData buf;
+    netBufferPool.Get(buf, 10);
+    BOOST_CHECK(buf.empty());
+    BOOST_CHECK(buf.capacity() >= NET_BUFFER_MIN_CLASS_SIZE);
+    BOOST_CHECK_EQUAL(netBufferPool.misses(), nMisses + 1);
+    const char *pMem = buf.data();
+
+    // returning it leaves the caller's buffer empty and the pool holding the memory
+    buf.resize(100);
+    netBufferPool.Put(buf);
+    BOOST_CHECK_EQUAL(buf.capacity(), 0);
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 1);
+
+    // the same memory is handed out again for a request of the same class
+    CSerializeData buf2;
+    netBufferPool.Get(buf2, NET_BUFFER_MIN_CLASS_SIZE);
+    BOOST_CHECK(buf2.empty());
+    BOOST_CHECK(buf2.data() == pMem);
+    BOOST_CHECK_EQUAL(netBufferPool.hits(), nHits + 1);
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 0);
+
+    // but not for a bigger class
+    netBufferPool.Put(buf2);
+    CSerializeData buf3;
+    netBufferPool.Get(buf3, NET_BUFFER_MIN_CLASS_SIZE + 1);
+    BOOST_CHECK(buf3.capacity() >= 2 * NET_BUFFER_MIN_CLASS_SIZE);
+    BOOST_CHECK_EQUAL(netBufferPool.misses(), nMisses + 2);
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 1);
+    netBufferPool.Put(buf3);
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 2);
+
+    netBufferPool.Clear();
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(netbufferpool_oversize)
+{
+    netBufferPool.Clear();
+    uint64_t nDiscards = netBufferPool.discards();
+
+    // buffers bigger than the largest class are allocated to size and freed when returned
+    CSerializeData buf;
+    netBufferPool.Get(buf, 3 * NET_BUFFER_MAX_CLASS_SIZE);
+    BOOST_CHECK(buf.capacity() >= 3 * NET_BUFFER_MAX_CLASS_SIZE);
+    netBufferPool.Put(buf);
+    BOOST_CHECK_EQUAL(buf.capacity(), 0);
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 0);
+    BOOST_CHECK_EQUAL(netBufferPool.discards(), nDiscards + 1);
+
+    // a buffer that grew past its class after being handed out is kept in the class it can still serve
+    netBufferPool.Get(buf, NET_BUFFER_MIN_CLASS_SIZE);
+    buf.resize(5 * NET_BUFFER_MIN_CLASS_SIZE);
+    netBufferPool.Put(buf);
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 1);
+    netBufferPool.Get(buf, 4 * NET_BUFFER_MIN_CLASS_SIZE);
+    BOOST_CHECK(buf.capacity() >= 5 * NET_BUFFER_MIN_CLASS_SIZE);
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 0);
+    netBufferPool.Put(buf);
+    netBufferPool.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(netbufferpool_datastream)
+{
+    netBufferPool.Clear();
+
+    // serializing into a pooled buffer does not reallocate it
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << std::string(300, 'x');
+    CSerializeData buf;
+    netBufferPool.Get(buf, ss.size());
+    const char *pMem = buf.data();
+    ss.GetAndClear(buf);
+    BOOST_CHECK(buf.data() == pMem);
+    BOOST_CHECK_EQUAL(buf.size(), 303);
+
+    // swap moves the buffer into a stream for reading
+    CDataStream ssRead(SER_NETWORK, PROTOCOL_VERSION);
+    ssRead.swap(buf);
+    BOOST_CHECK(buf.empty());
+    std::string str;
+    ssRead >> str;
+    BOOST_CHECK_EQUAL(str, std::string(300, 'x'));
+    BOOST_CHECK(ssRead.empty());
+
+    // and back out again, keeping its memory, so it can be returned to the pool
+    ssRead.swap(buf);
+    BOOST_CHECK(buf.data() == pMem);
+    BOOST_CHECK(buf.capacity() >= 303);
+    netBufferPool.Put(buf);
+    BOOST_CHECK_EQUAL(netBufferPool.Idle(), 1);
+    netBufferPool.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
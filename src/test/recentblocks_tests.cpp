@@ -0,0 +1,97 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockrelay/blockrelay_common.h"
+#include "chainparams.h"
+#include "hashwrapper.h"
+#include "net.h"
+#include "random.h"
+#include "streams.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+// Check that msg is a complete block message for block
+static void CheckBlockMessage(const CSerializeData &msg, const CBlock &block)
+{
+    BOOST_REQUIRE(msg.size() > CMessageHeader::HEADER_SIZE);
+    CDataStream ss(msg.begin(), msg.end(), SER_NETWORK, PROTOCOL_VERSION);
+    CMessageHeader hdr(Params().MessageStart());
+    ss >> hdr;
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), NetMsgType::BLOCK);
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, ss.size());
+
+    uint256 hash = Hash(ss.begin(), ss.end());
+    BOOST_CHECK(memcmp(hash.begin(), &hdr.nChecksum, CMessageHeader::CHECKSUM_SIZE) == 0);
+
+    CBlock blockRead;
+    ss >> blockRead;
+    BOOST_CHECK(blockRead.GetHash() == block.GetHash());
+    BOOST_CHECK(ss.empty());
+}
+
+BOOST_FIXTURE_TEST_SUITE(recentblocks_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(recentblocks_push)
+{
+    recentblocks.Clear();
+    uint64_t nHits = recentblocks.hits();
+    uint64_t nMisses = recentblocks.misses();
+
+    const CBlock &block = Params().GenesisBlock();
+    CAddress addr(ipaddress(0xa0b0c001, 10000));
+    CNode dummyNode(INVALID_SOCKET, addr, "", true);
+
+    // not cached yet
+    BOOST_CHECK(!recentblocks.PushBlock(&dummyNode, block.GetHash()));
+    BOOST_CHECK(dummyNode.vSendMsg.empty());
+
+    // the first send serializes and caches the block
+    recentblocks.PushBlock(&dummyNode, block);
+    BOOST_CHECK(recentblocks.Contains(block.GetHash()));
+    BOOST_REQUIRE_EQUAL(dummyNode.vSendMsg.size(), 1);
+    CheckBlockMessage(dummyNode.vSendMsg.front(), block);
+
+    // later ones, by block or by hash, send the same bytes from the cache
+    recentblocks.PushBlock(&dummyNode, block);
+    BOOST_CHECK(recentblocks.PushBlock(&dummyNode, block.GetHash()));
+    BOOST_REQUIRE_EQUAL(dummyNode.vSendMsg.size(), 3);
+    BOOST_CHECK(dummyNode.vSendMsg[1] == dummyNode.vSendMsg[0]);
+    BOOST_CHECK(dummyNode.vSendMsg[2] == dummyNode.vSendMsg[0]);
+
+    BOOST_CHECK_EQUAL(recentblocks.hits(), nHits + 2);
+    BOOST_CHECK_EQUAL(recentblocks.misses(), nMisses + 2);
+    recentblocks.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(recentblocks_evict)
+{
+    recentblocks.Clear();
+
+    // Add returns the checksum of the payload, which follows the room left for the header
+    CSerializeData msg(CMessageHeader::HEADER_SIZE, 0);
+    msg.push_back('x');
+    uint256 hash = Hash(msg.begin() + CMessageHeader::HEADER_SIZE, msg.end());
+    uint32_t nChecksum;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    BOOST_CHECK_EQUAL(recentblocks.Add(GetRandHash(), msg), nChecksum);
+
+    // only the most recent blocks are kept
+    std::vector<uint256> vHashes;
+    for (size_t i = 0; i < RECENT_BLOCK_CACHE_SIZE + 2; i++)
+    {
+        vHashes.push_back(GetRandHash());
+        recentblocks.Add(vHashes.back(), msg);
+    }
+    for (size_t i = 0; i < vHashes.size(); i++)
+        BOOST_CHECK_EQUAL(recentblocks.Contains(vHashes[i]), i >= vHashes.size() - RECENT_BLOCK_CACHE_SIZE);
+
+    // adding a cached block again does not evict anything
+    recentblocks.Add(vHashes.back(), msg);
+    BOOST_CHECK(recentblocks.Contains(vHashes[vHashes.size() - RECENT_BLOCK_CACHE_SIZE]));
+    recentblocks.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
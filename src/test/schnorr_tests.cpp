@@ -7,6 +7,7 @@
 #include "script/sighashtype.h"
 #include "test/test_bitcoin.h"
 
+#include "parallel.h"
 #include "script/interpreter.h"
 
 #include <boost/test/unit_test.hpp>
@@ -178,4 +179,64 @@ BOOST_AUTO_TEST_CASE(opcodes_random_flags) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(batch_script_checks)
+{
+    const uint32_t flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC | SCRIPT_VERIFY_NULLFAIL |
+                           SCRIPT_ENABLE_SIGHASH_FORKID;
+    const SigHashType sigHashType = SigHashType().withForkId();
+    const CAmount amount = 1000;
+
+    // spend a pay-to-pubkey output with a Schnorr signature
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = amount;
+    uint256 sighash = SignatureHash(scriptPubKey, CTransaction(mtx), 0, sigHashType.getRawSigHashType(), amount);
+    std::vector<uint8_t> vchSig;
+    BOOST_CHECK(key.SignSchnorr(sighash, vchSig));
+    mtx.vin[0].scriptSig = CScript() << SignatureWithHashType(vchSig, sigHashType);
+    CTransaction txGood(mtx);
+    vchSig[10] ^= 1;
+    mtx.vin[0].scriptSig = CScript() << SignatureWithHashType(vchSig, sigHashType);
+    CTransaction txBad(mtx);
+
+    CScriptCheck checkGood(nullptr, scriptPubKey, amount, txGood, 0, flags, MAXOPS, false);
+    CScriptCheck checkBad(nullptr, scriptPubKey, amount, txBad, 0, flags, MAXOPS, false);
+    BOOST_CHECK(checkGood());
+    BOOST_CHECK(!checkBad());
+
+    bool fDefault = schnorrBatchVerify.Value();
+    schnorrBatchVerify.Set(UniValue(true));
+    CCheckQueueBatch<CScriptCheck> batch;
+
+    batch.Begin();
+    BOOST_CHECK(checkGood());
+    BOOST_CHECK_EQUAL(batch.schnorrBatch.size(), 1);
+    BOOST_CHECK(batch.End(true));
+
+    // the invalid signature passes the script check, but not the batch
+    batch.Begin();
+    BOOST_CHECK(checkGood());
+    BOOST_CHECK(checkBad());
+    BOOST_CHECK_EQUAL(batch.vOrigins.size(), 2);
+    BOOST_CHECK(batch.vOrigins[1].first == txBad.GetHash());
+    BOOST_CHECK(!batch.End(true));
+    BOOST_CHECK(batch.schnorrBatch.empty());
+
+    // nothing is batched outside of Begin() and End(), or without NULLFAIL
+    BOOST_CHECK(!checkBad());
+    batch.Begin();
+    CScriptCheck checkBadNoNullFail(
+        nullptr, scriptPubKey, amount, txBad, 0, flags & ~SCRIPT_VERIFY_NULLFAIL, MAXOPS, false);
+    BOOST_CHECK(!checkBadNoNullFail());
+    BOOST_CHECK(batch.schnorrBatch.empty());
+    BOOST_CHECK(!batch.End(false));
+
+    schnorrBatchVerify.Set(UniValue(fDefault));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
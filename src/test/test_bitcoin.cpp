@@ -26,6 +26,7 @@
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
+#include "utxostats.h"
 #include "validation/validation.h"
 
 #include <memory>
@@ -69,9 +70,10 @@ TestingSetup::TestingSetup(const std::string &chainName) : BasicTestingSetup(cha
     pblocktree = new CBlockTreeDB(1 << 20, "", true);
     pcoinsdbview = new CCoinsViewDB(1 << 23, true);
     pcoinsTip = new CCoinsViewCache(pcoinsdbview);
-    txCommitQ = new std::map<uint256, CTxCommitData>();
     bool worked = InitBlockIndex(chainparams);
     assert(worked);
+    worked = LoadUTXOStats(pcoinsdbview);
+    assert(worked);
 
     // Initial dbcache settings so that the automatic cache setting don't kick in and allow
     // us to accidentally use up our RAM on Travis, and also so that we are not prevented from flushing the
@@ -93,6 +95,8 @@ TestingSetup::~TestingSetup()
     threadGroup.interrupt_all();
     threadGroup.join_all();
     UnloadBlockIndex();
+    txCommitQ.Clear();
+    g_utxostats.reset();
     delete pcoinsTip;
     delete pcoinsdbview;
     delete pblocktree;
@@ -0,0 +1,134 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txadmission.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+#include <set>
+#include <thread>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(txcommitqueue_tests, BasicTestingSetup)
+
+static CTxCommitData MakeCommitData(uint32_t n)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256(), n);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = n;
+
+    TestMemPoolEntryHelper entry;
+    CTxCommitData data;
+    data.entry = entry.FromTx(tx);
+    data.hash = tx.GetHash();
+    return data;
+}
+
+BOOST_AUTO_TEST_CASE(commitqueue_basics)
+{
+    CTxCommitQueue q;
+    BOOST_CHECK(q.Empty());
+
+    std::vector<uint256> vHashes;
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        CTxCommitData data = MakeCommitData(i);
+        vHashes.push_back(data.hash);
+        BOOST_CHECK(q.Push(std::move(data)));
+    }
+    // A transaction that is already queued is dropped
+    BOOST_CHECK(!q.Push(MakeCommitData(3)));
+    BOOST_CHECK_EQUAL(q.Size(), 10U);
+    BOOST_CHECK(q.Get(vHashes[3]) != nullptr);
+    BOOST_CHECK(q.Get(vHashes[3])->GetHash() == vHashes[3]);
+    BOOST_CHECK(!q.Exists(MakeCommitData(10).hash));
+
+    std::vector<uint256> vQueried;
+    q.QueryHashes(vQueried);
+    BOOST_CHECK(std::set<uint256>(vQueried.begin(), vQueried.end()) ==
+                std::set<uint256>(vHashes.begin(), vHashes.end()));
+
+    // Taken transactions come out in the order they were published, and stay visible until they are forgotten
+    std::vector<CTxCommitData> vBatch;
+    q.Take(vBatch);
+    BOOST_REQUIRE_EQUAL(vBatch.size(), 10U);
+    for (size_t i = 0; i < vBatch.size(); i++)
+        BOOST_CHECK(vBatch[i].hash == vHashes[i]);
+    BOOST_CHECK(q.Exists(vHashes[0]));
+    BOOST_CHECK(!q.Push(MakeCommitData(0)));
+    BOOST_CHECK_EQUAL(q.Size(), 10U);
+
+    std::vector<CTxCommitData> vEmpty;
+    q.Take(vEmpty);
+    BOOST_CHECK(vEmpty.empty());
+
+    q.Forget(vBatch);
+    BOOST_CHECK(q.Empty());
+    BOOST_CHECK(!q.Exists(vHashes[0]));
+
+    // Clear hands back what it removes
+    BOOST_CHECK(q.Push(MakeCommitData(0)));
+    std::vector<CTxCommitData> vRemoved;
+    q.Clear(&vRemoved);
+    BOOST_CHECK_EQUAL(vRemoved.size(), 1U);
+    BOOST_CHECK(vRemoved[0].hash == vHashes[0]);
+    BOOST_CHECK(q.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(commitqueue_concurrent)
+{
+    CTxCommitQueue q;
+    const int nThreads = 4;
+    const uint32_t nPerThread = 500;
+
+    // Prepare the transactions first so that the publishers overlap as much as possible
+    std::vector<std::vector<CTxCommitData> > vData(nThreads);
+    for (int t = 0; t < nThreads; t++)
+    {
+        for (uint32_t i = 0; i < nPerThread; i++)
+            vData[t].push_back(MakeCommitData(t * nPerThread + i));
+    }
+
+    std::atomic<bool> fDone(false);
+    std::vector<CTxCommitData> vTaken;
+    std::thread consumer([&]() {
+        while (!fDone)
+        {
+            std::vector<CTxCommitData> vBatch;
+            q.Take(vBatch);
+            q.Forget(vBatch);
+            vTaken.insert(vTaken.end(), vBatch.begin(), vBatch.end());
+        }
+    });
+
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < nThreads; t++)
+    {
+        publishers.emplace_back([&q, &vData, t]() {
+            for (CTxCommitData &data : vData[t])
+                q.Push(std::move(data));
+        });
+    }
+    for (std::thread &thread : publishers)
+        thread.join();
+    fDone = true;
+    consumer.join();
+
+    std::vector<CTxCommitData> vRest;
+    q.Clear(&vRest);
+    vTaken.insert(vTaken.end(), vRest.begin(), vRest.end());
+    BOOST_CHECK(q.Empty());
+
+    // Every transaction came out exactly once
+    BOOST_CHECK_EQUAL(vTaken.size(), nThreads * nPerThread);
+    std::set<uint256> setTaken;
+    for (const CTxCommitData &data : vTaken)
+        setTaken.insert(data.hash);
+    BOOST_CHECK_EQUAL(setTaken.size(), nThreads * nPerThread);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -396,4 +396,47 @@ BOOST_FIXTURE_TEST_CASE(uncache_coins, TestChain100Setup)
     SetMockTime(0);
 }
 
+BOOST_FIXTURE_TEST_CASE(prefetch_coins, TestChain100Setup)
+{
+    BOOST_REQUIRE(PV->ThreadCount() > 0);
+    pcoinsTip->Flush();
+
+    // A block spending the coinbases, and an output created earlier in the same block
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbaseTxns[0]));
+    for (size_t i = 0; i < coinbaseTxns.size(); i++)
+    {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(coinbaseTxns[i].GetHash(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 11 * CENT;
+        block.vtx.push_back(MakeTransactionRef(tx));
+        pcoinsTip->Uncache(tx.vin[0].prevout);
+    }
+    CMutableTransaction child;
+    child.vin.resize(1);
+    child.vin[0].prevout = COutPoint(block.vtx[1]->GetHash(), 0);
+    block.vtx.push_back(MakeTransactionRef(child));
+
+    bool fSpent = false;
+    BOOST_CHECK(!pcoinsTip->HaveCoinInCache(block.vtx[1]->vin[0].prevout, fSpent));
+
+    // nothing is loaded when the tweak is off
+    prefetchCoins.Set(UniValue(false));
+    BOOST_CHECK(!PV->PrefetchCoins(block));
+    BOOST_CHECK(!pcoinsTip->HaveCoinInCache(block.vtx[1]->vin[0].prevout, fSpent));
+    prefetchCoins.Set(UniValue(true));
+
+    // otherwise all the coins the block spends are loaded, but nothing is made up for the ones that do not exist
+    BOOST_CHECK(PV->PrefetchCoins(block));
+    for (size_t i = 1; i < block.vtx.size() - 1; i++)
+    {
+        fSpent = true;
+        BOOST_CHECK(pcoinsTip->HaveCoinInCache(block.vtx[i]->vin[0].prevout, fSpent));
+        BOOST_CHECK(!fSpent);
+    }
+    BOOST_CHECK(!pcoinsTip->HaveCoinInCache(child.vin[0].prevout, fSpent));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxostats.h"
+
+#include "consensus/validation.h"
+#include "key.h"
+#include "main.h"
+#include "script/sign.h"
+#include "streams.h"
+#include "test/test_bitcoin.h"
+#include "txdb.h"
+#include "validation/forks.h"
+#include "validation/validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(utxostats_tests, TestChain100Setup)
+
+// Check the running statistics against a full scan of the coin database
+static void CheckRunningStats(CCoinsViewDB *view)
+{
+    CUTXOStats scanned;
+    std::unique_ptr<CUTXOStats> running;
+    BOOST_CHECK(ScanUTXOStats(view, scanned, &running));
+    BOOST_REQUIRE(running);
+    BOOST_CHECK(running->hashBlock == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK(running->hashBlock == scanned.hashBlock);
+    BOOST_CHECK_EQUAL(running->nTransactionOutputs, scanned.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(running->nTotalAmount, scanned.nTotalAmount);
+    BOOST_CHECK(running->GetMuHash() == scanned.GetMuHash());
+}
+
+static CMutableTransaction Spend(const CTransaction &prev, uint32_t n, const CScript &scriptPubKey, const CKey &key)
+{
+    unsigned int sighashType = SIGHASH_ALL;
+    if (IsUAHFforkActiveOnNextBlock(chainActive.Tip()->nHeight))
+        sighashType |= SIGHASH_FORKID;
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(prev.GetHash(), n);
+    tx.vout.resize(2);
+    tx.vout[0].nValue = prev.vout[n].nValue / 2;
+    tx.vout[0].scriptPubKey = scriptPubKey;
+    tx.vout[1].nValue = prev.vout[n].nValue / 2 - 1000;
+    tx.vout[1].scriptPubKey = scriptPubKey;
+
+    std::vector<uint8_t> vchSig;
+    uint256 hash = SignatureHash(prev.vout[n].scriptPubKey, tx, 0, sighashType, prev.vout[n].nValue, 0);
+    BOOST_CHECK(key.SignECDSA(hash, vchSig));
+    vchSig.push_back((uint8_t)sighashType);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(utxostats_connect_disconnect)
+{
+    BOOST_REQUIRE(g_utxostats);
+    CheckRunningStats(pcoinsdbview);
+    int64_t nCoins = g_utxostats->nTransactionOutputs;
+    uint256 hashMuHash = g_utxostats->GetMuHash();
+
+    // A block that spends a coinbase, and one of the outputs that creates in the same block
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    std::vector<CMutableTransaction> txns;
+    txns.push_back(Spend(coinbaseTxns[0], 0, scriptPubKey, coinbaseKey));
+    txns.push_back(Spend(CTransaction(txns[0]), 1, scriptPubKey, coinbaseKey));
+    CBlock block = CreateAndProcessBlock(txns, scriptPubKey);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    CheckRunningStats(pcoinsdbview);
+    // one coinbase spent, three outputs left unspent and the new coinbase
+    BOOST_CHECK_EQUAL(g_utxostats->nTransactionOutputs, nCoins + 3 - 1 + (int64_t)block.vtx[0]->vout.size());
+
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(DisconnectTip(state, Params().GetConsensus()));
+    }
+    CheckRunningStats(pcoinsdbview);
+    BOOST_CHECK_EQUAL(g_utxostats->nTransactionOutputs, nCoins);
+    BOOST_CHECK(g_utxostats->GetMuHash() == hashMuHash);
+
+    // The statistics stored with the coins are picked up again instead of being recomputed
+    BOOST_CHECK(pcoinsdbview->WriteUTXOStats(*g_utxostats));
+    CUTXOStats stored;
+    BOOST_CHECK(pcoinsdbview->ReadUTXOStats(stored));
+    BOOST_CHECK(stored.hashBlock == g_utxostats->hashBlock);
+    BOOST_CHECK(stored.GetMuHash() == hashMuHash);
+    BOOST_CHECK(LoadUTXOStats(pcoinsdbview));
+    BOOST_REQUIRE(g_utxostats);
+    BOOST_CHECK(g_utxostats->GetMuHash() == hashMuHash);
+}
+
+BOOST_AUTO_TEST_CASE(utxostats_serialize)
+{
+    CUTXOStats stats;
+    stats.hashBlock = GetRandHash();
+    stats.AddCoin(COutPoint(GetRandHash(), 1), Coin(CTxOut(5 * COIN, CScript() << OP_TRUE), 10, false));
+    stats.AddCoin(COutPoint(GetRandHash(), 0), Coin(CTxOut(50 * COIN, CScript() << OP_TRUE), 11, true));
+
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << stats;
+    CUTXOStats read;
+    ss >> read;
+    BOOST_CHECK(read.hashBlock == stats.hashBlock);
+    BOOST_CHECK_EQUAL(read.nTransactionOutputs, 2);
+    BOOST_CHECK_EQUAL(read.nTotalAmount, 55 * COIN);
+    BOOST_CHECK(read.GetMuHash() == stats.GetMuHash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
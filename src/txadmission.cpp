@@ -23,7 +23,10 @@
 #include "utiltime.h"
 #include "validation/validation.h"
 #include "validationinterface.h"
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -32,6 +35,42 @@
 
 using namespace std;
 
+/**
+ * The input queue of one transaction admission thread.
+ *
+ * A transaction is queued on the shard of the txid its first input spends from, and each coin it spends is marked in
+ * the conflict filter of the shard of that coin's txid.  So two transactions that spend the same coin are always
+ * checked against the same filter, the transactions spending the outputs of one parent go to the same thread, and
+ * each filter holds only the coins routed to it, which keeps its false positives (and the needless deferrals they
+ * cause) down.  Threads that lock more than one shard lock them in the order of nId.
+ */
+class CTxAdmissionShard
+{
+public:
+    const unsigned int nId;
+
+    CCriticalSection cs_shard;
+    CCond cv_shard;
+    //! Finds transactions that may conflict with other pending transactions spending coins routed to this shard
+    CFastFilter<4 * 1024 * 1024> incomingConflicts GUARDED_BY(cs_shard);
+    //! Transactions that are waiting for validation and are known not to conflict with others
+    std::queue<CTxInputData> txInQ GUARDED_BY(cs_shard);
+
+    std::atomic<uint64_t> nEnqueued{0};
+    std::atomic<uint64_t> nDeferred{0};
+    std::atomic<uint64_t> nProcessed{0};
+    std::atomic<uint64_t> nAccepted{0};
+
+    CTxAdmissionShard(unsigned int id) : nId(id) {}
+};
+
+// Created by StartTxAdmission before anything can be enqueued and not changed after, so it is read without a lock.
+// Until then transactions are deferred.
+static std::vector<std::unique_ptr<CTxAdmissionShard> > vTxAdmissionShards;
+
+// The size of txDeferQ, so that it can be checked without taking csTxInQ
+static std::atomic<size_t> nTxDeferQSize(0);
+
 static void TestConflictEnqueueTx(CTxInputData &txd);
 
 // The average commit batch size is used to limit the quantity of transactions that are moved from the defer queue
@@ -39,24 +78,93 @@ static void TestConflictEnqueueTx(CTxInputData &txd);
 // shuffled between the in queue and the defer queue with little progress being made.
 const uint64_t minCommitBatchSize = 10000;
 
-// avgCommitBatchSize is write protected by csCommitQ and is wrapped in std::atomic for reads.
+// avgCommitBatchSize is write protected by mempool.cs_txmempool and is wrapped in std::atomic for reads.
 std::atomic<uint64_t> avgCommitBatchSize(0);
 
 Snapshot txHandlerSnap;
 
 void ThreadCommitToMempool();
-void ThreadTxAdmission();
+void ThreadTxAdmission(CTxAdmissionShard *shard);
 void ProcessOrphans(std::vector<uint256> &vWorkQueue);
 
-CTransactionRef CommitQGet(uint256 hash)
+CTxCommitQueue::~CTxCommitQueue() { Clear(); }
+
+bool CTxCommitQueue::Push(CTxCommitData &&data)
+{
+    {
+        Stripe &stripe = StripeFor(data.hash);
+        LOCK(stripe.cs);
+        if (!stripe.txns.emplace(data.hash, data.entry.GetSharedTx()).second)
+            return false;
+    }
+    nSize++;
+
+    Node *node = new Node{std::move(data), head.load(std::memory_order_relaxed)};
+    while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+    return true;
+}
+
+void CTxCommitQueue::Take(std::vector<CTxCommitData> &vBatch)
+{
+    // Nothing but this exchange ever removes nodes, so there is no ABA problem on head
+    Node *node = head.exchange(nullptr, std::memory_order_acquire);
+
+    // The list runs from the newest to the oldest
+    size_t nStart = vBatch.size();
+    for (; node != nullptr;)
+    {
+        Node *next = node->next;
+        vBatch.emplace_back(std::move(node->data));
+        delete node;
+        node = next;
+    }
+    std::reverse(vBatch.begin() + nStart, vBatch.end());
+}
+
+void CTxCommitQueue::Forget(const std::vector<CTxCommitData> &vBatch)
+{
+    for (const CTxCommitData &data : vBatch)
+    {
+        Stripe &stripe = StripeFor(data.hash);
+        LOCK(stripe.cs);
+        if (stripe.txns.erase(data.hash))
+            nSize--;
+    }
+}
+
+void CTxCommitQueue::Clear(std::vector<CTxCommitData> *pvRemoved)
 {
-    boost::unique_lock<boost::mutex> lock(csCommitQ);
-    std::map<uint256, CTxCommitData>::iterator it = txCommitQ->find(hash);
-    if (it == txCommitQ->end())
+    std::vector<CTxCommitData> vBatch;
+    Take(vBatch);
+    Forget(vBatch);
+    if (pvRemoved)
+        pvRemoved->insert(pvRemoved->end(), vBatch.begin(), vBatch.end());
+}
+
+CTransactionRef CTxCommitQueue::Get(const uint256 &hash)
+{
+    Stripe &stripe = StripeFor(hash);
+    LOCK(stripe.cs);
+    auto it = stripe.txns.find(hash);
+    if (it == stripe.txns.end())
         return nullptr;
-    return it->second.entry.GetSharedTx();
+    return it->second;
+}
+
+void CTxCommitQueue::QueryHashes(std::vector<uint256> &vHashes)
+{
+    for (Stripe &stripe : stripes)
+    {
+        LOCK(stripe.cs);
+        for (const auto &it : stripe.txns)
+            vHashes.push_back(it.first);
+    }
 }
 
+CTransactionRef CommitQGet(uint256 hash) { return txCommitQ.Get(hash); }
+
 static inline uint256 IncomingConflictHash(const COutPoint &prevout)
 {
     uint256 hash = prevout.hash;
@@ -72,17 +180,93 @@ static inline uint256 IncomingConflictHash(const COutPoint &prevout)
     return hash;
 }
 
-void StartTxAdmission(thread_group &threadGroup)
+// The shard whose conflict filter tracks the spends of prevout.  The txid is mixed first because the filter's bit
+// positions come straight from its bits, and all coins of a shard would otherwise share some of them.
+static inline CTxAdmissionShard *CoinShard(const COutPoint &prevout)
+{
+    uint64_t nMixed = (prevout.hash.GetCheapHash() * 0x9E3779B97F4A7C15ULL) >> 32;
+    return vTxAdmissionShards[nMixed % vTxAdmissionShards.size()].get();
+}
+
+// The shard whose thread validates tx
+static inline CTxAdmissionShard *HomeShard(const CTransactionRef &tx)
+{
+    return tx->vin.empty() ? vTxAdmissionShards[0].get() : CoinShard(tx->vin[0].prevout);
+}
+
+static void LockShards(const std::vector<CTxAdmissionShard *> &shards)
+{
+    for (CTxAdmissionShard *shard : shards)
+        ENTER_CRITICAL_SECTION(shard->cs_shard);
+}
+
+static void UnlockShards(const std::vector<CTxAdmissionShard *> &shards)
+{
+    for (auto it = shards.rbegin(); it != shards.rend(); ++it)
+        LEAVE_CRITICAL_SECTION((*it)->cs_shard);
+}
+
+static std::vector<CTxAdmissionShard *> AllShards()
+{
+    std::vector<CTxAdmissionShard *> shards;
+    for (const auto &shard : vTxAdmissionShards)
+        shards.push_back(shard.get());
+    return shards;
+}
+
+// Put txd on the deferred queue
+static void DeferTx(const CTxInputData &txd) EXCLUSIVE_LOCKS_REQUIRED(csTxInQ)
 {
-    if (txCommitQ == nullptr)
-        txCommitQ = new std::map<uint256, CTxCommitData>();
+    txDeferQ.push(txd);
+    nTxDeferQSize = txDeferQ.size();
+}
+
+// Whether the input queues of every admission thread and the deferred queue are empty
+static bool TxAdmissionQueuesEmpty()
+{
+    for (const auto &shard : vTxAdmissionShards)
+    {
+        LOCK(shard->cs_shard);
+        if (!shard->txInQ.empty())
+            return false;
+    }
+    LOCK(csTxInQ);
+    return txDeferQ.empty();
+}
 
+std::vector<CTxAdmissionShardStats> GetTxAdmissionShardStats()
+{
+    std::vector<CTxAdmissionShardStats> vStats;
+    for (const auto &shard : vTxAdmissionShards)
+    {
+        CTxAdmissionShardStats stats;
+        stats.nThread = shard->nId;
+        {
+            LOCK(shard->cs_shard);
+            stats.nQueued = shard->txInQ.size();
+        }
+        stats.nEnqueued = shard->nEnqueued;
+        stats.nDeferred = shard->nDeferred;
+        stats.nProcessed = shard->nProcessed;
+        stats.nAccepted = shard->nAccepted;
+        vStats.push_back(stats);
+    }
+    return vStats;
+}
+
+void StartTxAdmission(thread_group &threadGroup)
+{
     txHandlerSnap.Load(); // Get an initial view for the transaction processors
 
-    // Start incoming transaction processing threads
-    for (unsigned int i = 0; i < numTxAdmissionThreads.Value(); i++)
+    // Start incoming transaction processing threads, each with its own input queue
+    if (vTxAdmissionShards.empty())
     {
-        threadGroup.create_thread(&ThreadTxAdmission);
+        for (unsigned int i = 0; i < std::max(numTxAdmissionThreads.Value(), 1U); i++)
+            vTxAdmissionShards.emplace_back(new CTxAdmissionShard(i));
+    }
+    for (const auto &shard : vTxAdmissionShards)
+    {
+        threadGroup.create_thread(boost::bind(&ThreadTxAdmission, shard.get()));
     }
 
     // Start tx commitment thread
@@ -91,7 +275,8 @@ void StartTxAdmission(thread_group &threadGroup)
 
 void StopTxAdmission()
 {
-    cvTxInQ.notify_all();
+    for (const auto &shard : vTxAdmissionShards)
+        shard->cv_shard.notify_all();
     cvCommitQ.notify_all();
 }
 
@@ -103,10 +288,7 @@ void FlushTxAdmission()
     {
         do // give the tx processing threads a chance to run
         {
-            {
-                LOCK(csTxInQ);
-                empty = txInQ.empty() & txDeferQ.empty();
-            }
+            empty = TxAdmissionQueuesEmpty();
             if (!empty)
                 MilliSleep(100);
         } while (!empty);
@@ -116,19 +298,13 @@ void FlushTxAdmission()
             do // wait for the commit thread to commit everything
             {
                 cvCommitQ.timed_wait(lock, boost::posix_time::milliseconds(100));
-            } while (!txCommitQ->empty());
+            } while (!txCommitQ.Empty());
         }
 
         { // block everything and check
             CORRAL(txProcessingCorral, CORRAL_TX_PAUSE);
-            {
-                LOCK(csTxInQ);
-                empty = txInQ.empty() & txDeferQ.empty();
-            }
-            {
-                boost::unique_lock<boost::mutex> lock(csCommitQ);
-                empty &= txCommitQ->empty();
-            }
+            empty = TxAdmissionQueuesEmpty();
+            empty &= txCommitQ.Empty();
         }
     }
 }
@@ -136,11 +312,11 @@ void FlushTxAdmission()
 // Put the tx on the tx admission queue for processing
 void EnqueueTxForAdmission(CTxInputData &txd)
 {
-    LOCK(csTxInQ);
     // If I have lots of deferred tx, its probably because there's too much volume, so defer new ones right away
-    if (txDeferQ.size() > 1000)
+    if (nTxDeferQSize > 1000)
     {
-        txDeferQ.push(txd);
+        LOCK(csTxInQ);
+        DeferTx(txd);
         return;
     }
 
@@ -150,11 +326,30 @@ void EnqueueTxForAdmission(CTxInputData &txd)
 
 static void TestConflictEnqueueTx(CTxInputData &txd)
 {
+    if (vTxAdmissionShards.empty())
+    {
+        // There is no thread to process it yet
+        LOCK(csTxInQ);
+        DeferTx(txd);
+        return;
+    }
+
+    // Lock the shards of every coin spent, so that the whole transaction is tested and queued before the filters
+    // can be reset.  Most transactions need only one or two.
+    CTxAdmissionShard *home = HomeShard(txd.tx);
+    std::vector<CTxAdmissionShard *> shards(1, home);
+    for (const CTxIn &inp : txd.tx->vin)
+        shards.push_back(CoinShard(inp.prevout));
+    std::sort(shards.begin(), shards.end(),
+        [](const CTxAdmissionShard *a, const CTxAdmissionShard *b) { return a->nId < b->nId; });
+    shards.erase(std::unique(shards.begin(), shards.end()), shards.end());
+
     bool conflict = false;
-    for (auto &inp : txd.tx->vin)
+    LockShards(shards);
+    for (const CTxIn &inp : txd.tx->vin)
     {
         uint256 hash = IncomingConflictHash(inp.prevout);
-        if (!incomingConflicts.checkAndSet(hash))
+        if (!CoinShard(inp.prevout)->incomingConflicts.checkAndSet(hash))
         {
             conflict = true;
             break;
@@ -167,13 +362,20 @@ static void TestConflictEnqueueTx(CTxInputData &txd)
     if (!conflict)
     {
         // LOG(MEMPOOL, "Enqueue for processing %x\n", txd.tx->GetHash().ToString());
-        txInQ.push(txd); // add this transaction onto the processing queue.
-        cvTxInQ.notify_one();
+        home->txInQ.push(txd); // add this transaction onto the processing queue.
+        home->nEnqueued++;
+        home->cv_shard.notify_one();
     }
-    else
+    UnlockShards(shards);
+
+    if (conflict)
     {
         LOG(MEMPOOL, "Fastfilter collision, deferred %x\n", txd.tx->GetHash().ToString());
-        txDeferQ.push(txd);
+        home->nDeferred++;
+        {
+            LOCK(csTxInQ);
+            DeferTx(txd);
+        }
 
         // By notifying the commitQ, the deferred queue can be processed right way which helps
         // to forward double spends as quickly as possible.
@@ -192,14 +394,8 @@ unsigned int TxAlreadyHave(const CInv &inv)
             return 1;
         if (recentRejects.contains(inv.hash))
             return 2;
-        {
-            boost::unique_lock<boost::mutex> lock(csCommitQ);
-            const auto &elem = txCommitQ->find(inv.hash);
-            if (elem != txCommitQ->end())
-            {
-                return 5;
-            }
-        }
+        if (txCommitQ.Exists(inv.hash))
+            return 5;
         if (mempool.exists(inv.hash))
             return 3;
         if (orphanpool.AlreadyHaveOrphan(inv.hash))
@@ -223,7 +419,7 @@ void ThreadCommitToMempool()
                 {
                     return;
                 }
-            } while (txCommitQ->empty() && txDeferQ.empty());
+            } while (txCommitQ.Empty() && nTxDeferQSize == 0);
         }
 
         {
@@ -271,28 +467,22 @@ void LimitMempoolSize(CTxMemPool &pool, size_t limit, unsigned long age)
 void CommitTxToMempool()
 {
     std::vector<uint256> vWhatChanged;
-    {
-        boost::unique_lock<boost::mutex> lock(csCommitQ);
-        avgCommitBatchSize = (avgCommitBatchSize * 24 + txCommitQ->size()) / 25;
-        LOG(MEMPOOL, "txadmission committing %d tx\n", txCommitQ->size());
-
-        LOCK(csCommitQFinal);
-        txCommitQFinal = txCommitQ;
-        txCommitQ = new std::map<uint256, CTxCommitData>();
-    }
+    std::vector<CTxCommitData> vBatch;
 
     // These transactions have already been validated so store them directly into the mempool.
     //
     // We must hold the mempool lock for the duration because we want to be sure that we don't end up
-    // doing this loop in the middle of a reorg where we might be clearing the mempool.
-    std::map<uint256, CTxCommitData> *q;
+    // doing this loop in the middle of a reorg where we might be clearing the mempool.  The batch is taken
+    // under it too, so that a reorg always finds the transactions either in the queue or in the mempool.
     {
         WRITELOCK(mempool.cs_txmempool);
-        LOCK(csCommitQFinal);
-        for (auto &it : *txCommitQFinal)
+        txCommitQ.Take(vBatch);
+        avgCommitBatchSize = (avgCommitBatchSize * 24 + vBatch.size()) / 25;
+        LOG(MEMPOOL, "txadmission committing %d tx\n", vBatch.size());
+
+        for (CTxCommitData &data : vBatch)
         {
-            CTxCommitData &data = it.second;
-            mempool._addUnchecked(it.first, data.entry, !IsInitialBlockDownload());
+            mempool._addUnchecked(data.hash, data.entry, !IsInitialBlockDownload());
             vWhatChanged.push_back(data.hash);
 
             // Indicate that this tx was fully processed/accepted and can now be removed from the
@@ -300,34 +490,36 @@ void CommitTxToMempool()
             CInv inv(MSG_TX, data.hash);
             requester.Received(inv, nullptr);
         }
-
-        // Copy the queue pointer. This is so we avoid a deadlock below when/if we SyncWithWallets()
-        q = txCommitQFinal;
-        txCommitQFinal = new std::map<uint256, CTxCommitData>;
+        txCommitQ.Forget(vBatch);
     }
 
+    // This is done outside of the mempool lock to avoid a deadlock when/if we SyncWithWallets()
 #ifdef ENABLE_WALLET
-    for (auto &it : *q)
+    for (CTxCommitData &data : vBatch)
     {
-        CTxCommitData &data = it.second;
         SyncWithWallets(data.entry.GetSharedTx(), nullptr, -1);
     }
 #endif
-    q->clear();
-    delete q;
 
     std::map<uint256, CTxInputData> mapWasDeferred;
     {
         LOCK(csTxInQ);
-        // Clear the filter of incoming conflicts, and put all queued tx on the deferred queue since they've been
+        std::vector<CTxAdmissionShard *> shards = AllShards();
+        LockShards(shards);
+        // Clear the filters of incoming conflicts, and put all queued tx on the deferred queue since they've been
         // deferred
-        LOG(MEMPOOL, "txadmission incoming filter reset.  Current txInQ size: %d\n", txInQ.size());
-        incomingConflicts.reset();
-        while (!txInQ.empty())
+        size_t nQueued = 0;
+        for (CTxAdmissionShard *shard : shards)
         {
-            txDeferQ.push(txInQ.front());
-            txInQ.pop();
+            nQueued += shard->txInQ.size();
+            shard->incomingConflicts.reset();
+            while (!shard->txInQ.empty())
+            {
+                txDeferQ.push(shard->txInQ.front());
+                shard->txInQ.pop();
+            }
         }
+        LOG(MEMPOOL, "txadmission incoming filter reset.  Current txInQ size: %d\n", nQueued);
         // If the chain is now syncd and there are txns in the wait queue then add these also to the deferred queue.
         // The wait queue is not very active and it will typically have just 1 or 2 txns in it, if any at all.
         while (IsChainSyncd() && !txWaitNextBlockQ.empty())
@@ -343,19 +535,22 @@ void CommitTxToMempool()
         // A transaction's inputs could cause a false positive match against each other.  By pushing the first
         // deferred tx without checking, we can still use the efficient fastfilter checkAndSet function for most queue
         // filter checking but mop up the extremely rare tx whose inputs have false positive matches here.
-        if (!txDeferQ.empty())
+        if (!txDeferQ.empty() && !shards.empty())
         {
             const CTxInputData &first = txDeferQ.front();
 
             for (const auto &inp : first.tx->vin)
             {
                 uint256 hash = IncomingConflictHash(inp.prevout);
-                incomingConflicts.insert(hash);
+                CoinShard(inp.prevout)->incomingConflicts.insert(hash);
             }
-            txInQ.push(first);
-            cvTxInQ.notify_one();
+            CTxAdmissionShard *home = HomeShard(first.tx);
+            home->txInQ.push(first);
+            home->nEnqueued++;
+            home->cv_shard.notify_one();
             txDeferQ.pop();
         }
+        UnlockShards(shards);
 
         // Use a map to store the txns so that we end up removing duplicates which could have arrived
         // from re-requests.
@@ -370,24 +565,22 @@ void CommitTxToMempool()
             mapWasDeferred.emplace(hash, txDeferQ.front());
             txDeferQ.pop();
         }
+        nTxDeferQSize = txDeferQ.size();
     }
 
     if (!mapWasDeferred.empty())
         LOG(MEMPOOL, "Enqueueing %d deferred tx\n", mapWasDeferred.size());
 
+    for (auto &it : mapWasDeferred)
     {
-        LOCK(csTxInQ);
-        for (auto &it : mapWasDeferred)
-        {
-            // LOG(MEMPOOL, "attempt enqueue deferred %s\n", it.first.ToString());
-            TestConflictEnqueueTx(it.second);
-        }
+        // LOG(MEMPOOL, "attempt enqueue deferred %s\n", it.first.ToString());
+        TestConflictEnqueueTx(it.second);
     }
     ProcessOrphans(vWhatChanged);
 }
 
 
-void ThreadTxAdmission()
+void ThreadTxAdmission(CTxAdmissionShard *shard)
 {
     // Process at most this many transactions before letting the commit thread take over
     const int maxTxPerRound = 200;
@@ -406,14 +599,14 @@ void ThreadTxAdmission()
         CTxInputData txd;
 
         {
-            CCriticalBlock lock(csTxInQ, "csTxInQ", __FILE__, __LINE__, LockType::RECURSIVE_MUTEX);
-            while (txInQ.empty() && shutdown_threads.load() == false)
+            CCriticalBlock lock(shard->cs_shard, "cs_shard", __FILE__, __LINE__, LockType::RECURSIVE_MUTEX);
+            while (shard->txInQ.empty() && shutdown_threads.load() == false)
             {
                 if (shutdown_threads.load() == true)
                 {
                     return;
                 }
-                cvTxInQ.wait(csTxInQ);
+                shard->cv_shard.wait(shard->cs_shard);
             }
             if (shutdown_threads.load() == true)
             {
@@ -429,8 +622,8 @@ void ThreadTxAdmission()
                 // tx must be popped within the TX_PROCESSING corral or the state break between processing
                 // and commitment will not be clean
                 {
-                    CCriticalBlock lock(csTxInQ, "csTxInQ", __FILE__, __LINE__, LockType::RECURSIVE_MUTEX);
-                    if (txInQ.empty())
+                    CCriticalBlock lock(shard->cs_shard, "cs_shard", __FILE__, __LINE__, LockType::RECURSIVE_MUTEX);
+                    if (shard->txInQ.empty())
                     {
                         // speed up tx chunk processing when there is nothing else to do
                         if (acceptedSomething)
@@ -439,8 +632,8 @@ void ThreadTxAdmission()
                     }
 
                     // Make a copy so we can pop and release
-                    txd = txInQ.front();
-                    txInQ.pop();
+                    txd = shard->txInQ.front();
+                    shard->txInQ.pop();
                 }
 
                 CTransactionRef &tx = txd.tx;
@@ -454,10 +647,12 @@ void ThreadTxAdmission()
                     // If mempool policy aware relay is on, then supply a structure to gather the needed data,
                     // otherwise nullptr turns it off.
                     CTxProperties *txProps = (unconfPushAction.Value() == 0) ? nullptr : &txProperties;
+                    shard->nProcessed++;
                     if (ParallelAcceptToMemoryPool(txHandlerSnap, mempool, state, tx, true, &fMissingInputs, false,
                             false, TransactionClass::DEFAULT, vCoinsToUncache, &isRespend, nullptr, txProps))
                     {
                         acceptedSomething = true;
+                        shard->nAccepted++;
                         RelayTransaction(tx, false, txProps);
 
                         // LOG(MEMPOOL, "Accepted tx: peer=%s: accepted %s onto Q\n", txd.nodeName,
@@ -1255,9 +1450,7 @@ bool ParallelAcceptToMemoryPool(Snapshot &ss,
             CTxCommitData eData;
             eData.entry = std::move(entry);
             eData.hash = hash;
-
-            boost::unique_lock<boost::mutex> lock(csCommitQ);
-            (*txCommitQ).emplace(eData.hash, eData);
+            txCommitQ.Push(std::move(eData));
         }
     }
     uint64_t interval = (GetStopwatch() - start) / 1000;
@@ -11,7 +11,10 @@
 #include "threadgroup.h"
 #include "txdebugger.h"
 #include "txmempool.h"
+
+#include <atomic>
 #include <queue>
+#include <unordered_map>
 
 /** The default value for -minrelaytxfee in sat/byte */
 static const double DEFAULT_MINLIMITERTXFEE = (double)DEFAULT_MIN_RELAY_TX_FEE / 1000;
@@ -95,6 +98,59 @@ public:
     uint256 hash;
 };
 
+/**
+ * The transactions that have been validated by the admission threads and are waiting to be committed to the mempool.
+ *
+ * Admission threads publish onto a lock-free list with a single compare and swap, and the commit thread takes
+ * everything published so far with one exchange, so publishing never waits for the commit thread or for another
+ * publisher.  Lookups by hash go to a side table split into independently locked stripes.  A transaction stays in
+ * the side table after it has been taken, until the commit thread has put it in the mempool and calls Forget.
+ */
+class CTxCommitQueue
+{
+protected:
+    struct Node
+    {
+        CTxCommitData data;
+        Node *next;
+    };
+
+    static const size_t NUM_STRIPES = 64;
+    struct Stripe
+    {
+        CCriticalSection cs;
+        std::unordered_map<uint256, CTransactionRef, SaltedTxidHasher> txns GUARDED_BY(cs);
+    };
+
+    //! the most recently published transaction, linked to the ones published before it
+    std::atomic<Node *> head;
+    //! the number of transactions in the side table
+    std::atomic<size_t> nSize;
+    Stripe stripes[NUM_STRIPES];
+
+    Stripe &StripeFor(const uint256 &hash) { return stripes[hash.GetCheapHash() % NUM_STRIPES]; }
+public:
+    CTxCommitQueue() : head(nullptr), nSize(0) {}
+    ~CTxCommitQueue();
+
+    /** Publish a validated transaction.  Returns false, and drops it, if that transaction is already queued. */
+    bool Push(CTxCommitData &&data);
+    /** Move every transaction published so far to the end of vBatch, in the order they were published */
+    void Take(std::vector<CTxCommitData> &vBatch);
+    /** Remove the transactions of a batch returned by Take from the side table */
+    void Forget(const std::vector<CTxCommitData> &vBatch);
+    /** Take and forget everything, optionally returning it */
+    void Clear(std::vector<CTxCommitData> *pvRemoved = nullptr);
+
+    /** Return the transaction with this hash if it is queued, or being committed, and nullptr otherwise */
+    CTransactionRef Get(const uint256 &hash);
+    bool Exists(const uint256 &hash) { return Get(hash) != nullptr; }
+    /** Add the hashes of the queued transactions to vHashes */
+    void QueryHashes(std::vector<uint256> &vHashes);
+    size_t Size() const { return nSize.load(); }
+    bool Empty() const { return Size() == 0; }
+};
+
 /** Communicate what class of transaction is acceptable to add to the memory pool
  */
 enum class TransactionClass
@@ -125,14 +181,8 @@ extern CTweak<unsigned int> numTxAdmissionThreads;
 extern CRollingFastFilter<4 * 1024 * 1024> recentRejects;
 extern CRollingFastFilter<4 * 1024 * 1024> txRecentlyInBlock;
 
-// Finds transactions that may conflict with other pending transactions
-extern CFastFilter<4 * 1024 * 1024> incomingConflicts;
-
-// Transactions that are available to be added to the mempool, and protection
-// Guarded by csTxInQ
+// Protects the queues of transactions that are not on the input queue of an admission thread
 extern CCriticalSection csTxInQ;
-extern CCond cvTxInQ;
-extern std::queue<CTxInputData> txInQ;
 
 // Transactions that cannot be processed in this round (may potentially conflict with other tx)
 // Guarded by csTxInQ
@@ -144,12 +194,11 @@ extern std::queue<CTxInputData> txDeferQ;
 // Guarded by csTxInQ
 extern std::queue<CTxInputData> txWaitNextBlockQ;
 
-// Transactions that are validated and can be committed to the mempool, and protection
+// Transactions that are validated and can be committed to the mempool
+extern CTxCommitQueue txCommitQ;
+// Wakes up the commit thread, and the threads waiting for it to finish a batch
 extern CWaitableCriticalSection csCommitQ;
 extern CConditionVariable cvCommitQ;
-extern std::map<uint256, CTxCommitData> *txCommitQ;
-extern CCriticalSection csCommitQFinal;
-extern std::map<uint256, CTxCommitData> *txCommitQFinal;
 
 // returns a transaction ref, if it exists in the commitQ
 CTransactionRef CommitQGet(uint256 hash);
@@ -164,6 +213,25 @@ void FlushTxAdmission();
 /// Put the tx on the tx admission queue for processing
 void EnqueueTxForAdmission(CTxInputData &txd);
 
+/** A snapshot of the counters of one transaction admission thread's input queue */
+struct CTxAdmissionShardStats
+{
+    unsigned int nThread;
+    //! transactions waiting on the queue now
+    uint64_t nQueued;
+    //! transactions that were put on the queue
+    uint64_t nEnqueued;
+    //! transactions routed to this queue that were deferred because they may conflict with a queued one
+    uint64_t nDeferred;
+    //! transactions validated by this thread
+    uint64_t nProcessed;
+    //! transactions this thread accepted into the commit queue
+    uint64_t nAccepted;
+};
+
+/** Return the counters of each transaction admission thread, or nothing if they have not been started */
+std::vector<CTxAdmissionShardStats> GetTxAdmissionShardStats();
+
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool &pool,
     CValidationState &state,
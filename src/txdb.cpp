@@ -11,6 +11,7 @@
 #include "pow.h"
 #include "ui_interface.h"
 #include "uint256.h"
+#include "utxostats.h"
 #include "validation/validation.h"
 
 #include <stdint.h>
@@ -30,6 +31,7 @@ static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_UTXO_STATS = 'U';
 
 
 namespace
@@ -58,18 +60,57 @@ struct CoinEntry
 }
 
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe)
-    : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true)
+    : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true),
+      fBackgroundFlush(GetBoolArg("-dbbackgroundflush", DEFAULT_DB_BACKGROUND_FLUSH)), fFlushFailed(false),
+      fShutdownFlush(false)
 {
 }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    WaitForFlush();
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        fShutdownFlush = true;
+    }
+    cvPending.notify_all();
+    if (flushThread.joinable())
+        flushThread.join();
+}
+
+std::shared_ptr<const CCoinsMap> CCoinsViewDB::PendingCoins() const
+{
+    boost::unique_lock<boost::mutex> lock(csPending);
+    return pendingCoins;
+}
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const
 {
+    std::shared_ptr<const CCoinsMap> pending = PendingCoins();
+    if (pending)
+    {
+        CCoinsMap::const_iterator it = pending->find(outpoint);
+        if (it != pending->end())
+        {
+            if (it->second.coin.IsSpent())
+                return false;
+            coin = it->second.coin;
+            return true;
+        }
+    }
     READLOCK(cs_utxo);
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const
 {
+    std::shared_ptr<const CCoinsMap> pending = PendingCoins();
+    if (pending)
+    {
+        CCoinsMap::const_iterator it = pending->find(outpoint);
+        if (it != pending->end())
+            return !it->second.coin.IsSpent();
+    }
     READLOCK(cs_utxo);
     return db.Exists(CoinEntry(&outpoint));
 }
@@ -84,6 +125,12 @@ uint256 CCoinsViewDB::_GetBestBlock() const
 {
     AssertLockHeld(cs_utxo);
     uint256 hashBestChain;
+    {
+        // coins that are still being written lead to a newer best block than the one in the database
+        boost::unique_lock<boost::mutex> lock(csPending);
+        if (pendingCoins && !hashPendingBlock.IsNull())
+            return hashPendingBlock;
+    }
     std::string strmode = std::to_string(static_cast<int32_t>(BLOCK_DB_MODE));
     if (pblockdb)
     {
@@ -129,6 +176,7 @@ uint256 CCoinsViewDB::_GetBestBlock(BlockDBMode mode) const
 
 void CCoinsViewDB::WriteBestBlock(const uint256 &hashBlock)
 {
+    WaitForFlush();
     WRITELOCK(cs_utxo);
     _WriteBestBlock(hashBlock);
 }
@@ -153,6 +201,7 @@ void CCoinsViewDB::_WriteBestBlock(const uint256 &hashBlock)
 
 void CCoinsViewDB::WriteBestBlock(const uint256 &hashBlock, BlockDBMode mode)
 {
+    WaitForFlush();
     WRITELOCK(cs_utxo);
     _WriteBestBlock(hashBlock);
 }
@@ -179,8 +228,15 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     const uint64_t nBestCoinHeight,
     size_t &nChildCachedCoinsUsage)
 {
+    // Let the previous set of coins finish committing so that only one set is ever held in memory.
+    if (!WaitForFlush())
+        return false;
+
     WRITELOCK(cs_utxo);
     CDBBatch batch(db);
+    std::shared_ptr<CCoinsMap> pending;
+    if (fBackgroundFlush)
+        pending = std::make_shared<CCoinsMap>();
     size_t count = 0;
     size_t changed = 0;
     size_t nBatchWrites = 0;
@@ -192,9 +248,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
         {
             CoinEntry entry(&it->first);
             size_t nUsage = it->second.coin.DynamicMemoryUsage();
+            if (pending)
+                pending->emplace(it->first, CCoinsCacheEntry(Coin(it->second.coin)));
             if (it->second.coin.IsSpent())
             {
-                batch.Erase(entry);
+                if (!pending)
+                    batch.Erase(entry);
 
                 // Update the usage of the child cache before deleting the entry in the child cache
                 nChildCachedCoinsUsage -= nUsage;
@@ -202,7 +261,8 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
             }
             else
             {
-                batch.Write(entry, it->second.coin);
+                if (!pending)
+                    batch.Write(entry, it->second.coin);
 
                 // Only delete valid coins from the cache when we're nearly syncd.  During IBD, and also
                 // if BlockOnly mode is turned on, these coins will be used, whereas, once the chain is
@@ -236,6 +296,23 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
             it++;
         count++;
     }
+
+    if (pending)
+    {
+        LOG(COINDB, "Handing %u changed transactions (out of %u) to the coin database writer...\n",
+            (unsigned int)changed, (unsigned int)count);
+        {
+            boost::unique_lock<boost::mutex> lock(csPending);
+            pendingCoins = pending;
+            hashPendingBlock = hashBlock;
+            if (!flushThread.joinable())
+                flushThread = std::thread(&TraceThread<std::function<void()> >, "coinflush",
+                    std::function<void()>(std::bind(&CCoinsViewDB::ThreadFlush, this)));
+        }
+        cvPending.notify_all();
+        return true;
+    }
+
     if (!hashBlock.IsNull())
         _WriteBestBlock(hashBlock);
 
@@ -246,12 +323,94 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     return ret;
 }
 
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    int64_t nStart = GetStopwatchMicros();
+    CDBBatch batch(db);
+    size_t nBatchWrites = 0;
+    for (const auto &item : mapCoins)
+    {
+        CoinEntry entry(&item.first);
+        if (item.second.coin.IsSpent())
+            batch.Erase(entry);
+        else
+            batch.Write(entry, item.second.coin);
+        if (batch.SizeEstimate() > nMaxDBBatchSize)
+        {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+            nBatchWrites++;
+        }
+    }
+    if (!db.WriteBatch(batch))
+        return false;
+
+    // The best block goes in last so that it never points past the coins in the database.
+    {
+        WRITELOCK(cs_utxo);
+        _WriteBestBlock(hashBlock);
+    }
+    LOG(COINDB, "Committed %u changed transactions to coin database with %u batch writes in %.2fms\n",
+        (unsigned int)mapCoins.size(), (unsigned int)nBatchWrites + 1, (GetStopwatchMicros() - nStart) * 0.001);
+    return true;
+}
+
+void CCoinsViewDB::ThreadFlush()
+{
+    while (true)
+    {
+        std::shared_ptr<const CCoinsMap> coins;
+        uint256 hashBlock;
+        {
+            boost::unique_lock<boost::mutex> lock(csPending);
+            while (!pendingCoins && !fShutdownFlush)
+                cvPending.wait(lock);
+            if (!pendingCoins)
+                return;
+            coins = pendingCoins;
+            hashBlock = hashPendingBlock;
+        }
+
+        bool fOk = WriteCoins(*coins, hashBlock);
+        if (!fOk)
+            LOGA("ERROR: %s: failed to write to coin database\n", __func__);
+        {
+            boost::unique_lock<boost::mutex> lock(csPending);
+            pendingCoins.reset();
+            hashPendingBlock.SetNull();
+            fFlushFailed |= !fOk;
+        }
+        cvPending.notify_all();
+    }
+}
+
+bool CCoinsViewDB::WaitForFlush() const
+{
+    boost::unique_lock<boost::mutex> lock(csPending);
+    while (pendingCoins)
+        cvPending.wait(lock);
+    return !fFlushFailed;
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     READLOCK(cs_utxo);
     return db.EstimateSize(DB_COIN, (char)(DB_COIN + 1));
 }
 
+bool CCoinsViewDB::ReadUTXOStats(CUTXOStats &stats) const
+{
+    READLOCK(cs_utxo);
+    return db.Read(DB_UTXO_STATS, stats);
+}
+
+bool CCoinsViewDB::WriteUTXOStats(const CUTXOStats &stats)
+{
+    WRITELOCK(cs_utxo);
+    return db.Write(DB_UTXO_STATS, stats);
+}
+
 size_t CCoinsViewDB::TotalWriteBufferSize() const
 {
     READLOCK(cs_utxo);
@@ -283,13 +442,17 @@ bool CBlockTreeDB::ReadReindexing(bool &fReindexing)
 }
 
 bool CBlockTreeDB::ReadLastBlockFile(int &nFile) { return Read(DB_LAST_BLOCK, nFile); }
-CCoinsViewCursor *CCoinsViewDB::Cursor() const
+CCoinsViewCursor *CCoinsViewDB::Cursor() const { return Cursor(uint256()); }
+CCoinsViewCursor *CCoinsViewDB::Cursor(const uint256 &hashStart) const
 {
+    // the cursor reads the database directly, so it must not start before the pending coins are in it
+    WaitForFlush();
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper *>(&db)->NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
-    i->pcursor->Seek(DB_COIN);
+    COutPoint start(hashStart, 0);
+    i->pcursor->Seek(CoinEntry(&start));
     // Cache key of first record
     if (i->pcursor->Valid())
     {
@@ -13,7 +13,9 @@
 #include "dbwrapper.h"
 
 #include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -46,6 +48,8 @@ static const int64_t DEFAULT_HIGH_PERF_MEM_CUTOFF = 2048 * 1000 * 1000;
 static const uint64_t nMinMemToKeepAvailable = 300 * 1000 * 1000;
 //! the max size a batch can get before a write to the utxo is made
 static const size_t nMaxDBBatchSize = 16 << 20;
+//! Write flushed coins to the coin database on a background thread by default
+static const bool DEFAULT_DB_BACKGROUND_FLUSH = true;
 //! Max memory allocated to block tree DB specific cache, if no -txindex (MiB)
 static const int64_t nMaxBlockDBCache = 2;
 
@@ -115,15 +119,39 @@ struct CDiskTxPos : public CDiskBlockPos
 };
 
 class CCoinsViewDBCursor;
+class CUTXOStats;
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With background flushing on, BatchWrite only takes the dirty coins out of the cache and hands them to a writer
+ * thread, which commits them in bounded batches and writes the best block last.  Until that is done the handed off
+ * coins are served from memory, so readers never see the partially written database.
+ */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
 
+private:
+    const bool fBackgroundFlush;
+    mutable CWaitableCriticalSection csPending;
+    mutable CConditionVariable cvPending;
+    /** Coins handed to the writer thread and not yet committed, and the best block they lead to */
+    std::shared_ptr<const CCoinsMap> pendingCoins;
+    uint256 hashPendingBlock;
+    bool fFlushFailed;
+    bool fShutdownFlush;
+    std::thread flushThread;
+
+    std::shared_ptr<const CCoinsMap> PendingCoins() const;
+    /** Commit coins and then the best block hashBlock in batches of at most nMaxDBBatchSize */
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+    void ThreadFlush();
+
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -140,6 +168,15 @@ public:
         const uint64_t nBestCoinHeight,
         size_t &nChildCachedCoinsUsage) override;
     CCoinsViewCursor *Cursor() const override;
+    //! A cursor over the coins of txid hashStart and the ones after it
+    CCoinsViewCursor *Cursor(const uint256 &hashStart) const;
+
+    //! The running UTXO set statistics, stored alongside the coins
+    bool ReadUTXOStats(CUTXOStats &stats) const;
+    bool WriteUTXOStats(const CUTXOStats &stats);
+
+    //! Block until coins handed to the background writer are committed. Returns false if committing failed.
+    bool WaitForFlush() const;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
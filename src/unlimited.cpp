@@ -26,6 +26,7 @@
 #include "leakybucket.h"
 #include "miner.h"
 #include "net.h"
+#include "netbufferpool.h"
 #include "parallel.h"
 #include "policy/policy.h"
 #include "primitives/block.h"
@@ -516,6 +517,12 @@ void UnlimitedCleanup()
     recvAmt.Stop();
     sendAmt.Stop();
     nTxValidationTime.Stop();
+    netBufferPool.Stop();
+    recentblocks.Stop();
+    nPrefetchLoaded.Stop();
+    nPrefetchCached.Stop();
+    nPrefetchMissing.Stop();
+    nPrefetchTimeSaved.Stop();
     {
         LOCK(cs_blockvalidationtime);
         nBlockValidationTime.Stop();
@@ -2150,9 +2157,7 @@ UniValue validateblocktemplate(const UniValue &params, bool fHelp)
 extern std::vector<std::string> vUseDNSSeeds;
 extern std::list<CNode *> vNodesDisconnected;
 extern std::set<CNetAddr> setservAddNodeAddresses;
-extern std::map<uint256, CTxCommitData> *txCommitQ;
 extern std::queue<CTxInputData> txDeferQ;
-extern std::queue<CTxInputData> txInQ;
 extern UniValue getstructuresizes(const UniValue &params, bool fHelp)
 {
     UniValue ret(UniValue::VOBJ);
@@ -2210,9 +2215,11 @@ extern UniValue getstructuresizes(const UniValue &params, bool fHelp)
     ret.pushKV("xpeditedBlkUp", (uint64_t)nExpeditedUpstream);
     ret.pushKV("xpeditedTxn", (uint64_t)nExpeditedTxs);
 
-    if (txCommitQ)
-        ret.pushKV("txCommitQ", (uint64_t)txCommitQ->size());
-    ret.pushKV("txInQ", (uint64_t)txInQ.size());
+    ret.pushKV("txCommitQ", (uint64_t)txCommitQ.Size());
+    uint64_t nTxInQ = 0;
+    for (const CTxAdmissionShardStats &stats : GetTxAdmissionShardStats())
+        nTxInQ += stats.nQueued;
+    ret.pushKV("txInQ", nTxInQ);
     ret.pushKV("txDeferQ", (uint64_t)txDeferQ.size());
 #ifdef DEBUG_LOCKORDER
     {
@@ -0,0 +1,186 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxosnapshot.h"
+
+#include "blockstorage/blockstorage.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "consensus/validation.h"
+#include "main.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation/validation.h"
+
+#include <boost/thread/thread.hpp>
+
+//! Number of coins written to the coin database at a time while loading a snapshot
+static const uint64_t SNAPSHOT_LOAD_BATCH = 500000;
+
+CUTXOSnapshotHeader DumpUTXOSnapshot(CCoinsViewDB *view, const fs::path &path)
+{
+    int64_t nStart = GetStopwatchMicros();
+    CUTXOSnapshotHeader header;
+    memcpy(header.pchMessageStart, Params().MessageStart(), sizeof(header.pchMessageStart));
+
+    // Take the cursor and the header chain of its best block while no block can be connected.
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    std::vector<std::pair<CBlockHeader, uint32_t> > vHeaders;
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
+            throw std::runtime_error("unable to flush the chainstate: " + state.GetRejectReason());
+        pcursor.reset(view->Cursor());
+        header.hashBlock = pcursor->GetBestBlock();
+        CBlockIndex *pindex = LookupBlockIndex(header.hashBlock);
+        if (!pindex)
+            throw std::runtime_error("the best block of the coin database is not in the block index");
+        header.nHeight = pindex->nHeight;
+        vHeaders.resize(header.nHeight);
+        READLOCK(cs_mapBlockIndex);
+        for (; pindex->pprev; pindex = pindex->pprev)
+            vHeaders[pindex->nHeight - 1] = std::make_pair(pindex->GetBlockHeader(), pindex->nTx);
+    }
+
+    fs::path pathTmp = path.string() + ".incomplete";
+    CAutoFile file(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        throw std::runtime_error("unable to open " + pathTmp.string() + " for writing");
+
+    // The coin count and hash are filled in once all the coins have been written.
+    file << header;
+    for (const auto &item : vHeaders)
+        file << item.first << item.second;
+
+    CCoinsStats stats;
+    CCoinsStatsHasher hasher(stats, header.hashBlock);
+    for (; pcursor->Valid(); pcursor->Next())
+    {
+        boost::this_thread::interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin))
+            throw std::runtime_error("unable to read the coin database");
+        file << key << coin;
+        hasher.Add(key, std::move(coin));
+        header.nCoins++;
+    }
+    header.hashSerialized = hasher.Finalize();
+
+    if (fseek(file.Get(), 0, SEEK_SET))
+        throw std::runtime_error("unable to seek in " + pathTmp.string());
+    file << header;
+    FileCommit(file.Get());
+    file.fclose();
+    if (!RenameOver(pathTmp, path))
+        throw std::runtime_error("unable to rename " + pathTmp.string());
+
+    LOGA("Dumped UTXO snapshot of %u coins at block %s height %d in %.2fs\n", header.nCoins,
+        header.hashBlock.ToString(), header.nHeight, (GetStopwatchMicros() - nStart) * 0.000001);
+    return header;
+}
+
+bool LoadUTXOSnapshot(const fs::path &path, const uint256 &hashExpected, const CChainParams &chainparams)
+{
+    int64_t nStart = GetStopwatchMicros();
+    LOCK(cs_main);
+    if (chainActive.Height() > 0)
+    {
+        LOGA("Not loading UTXO snapshot %s, the chain is already at height %d\n", path.string(), chainActive.Height());
+        return true;
+    }
+
+    try
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull())
+            return error("%s: unable to open %s", __func__, path.string());
+
+        CUTXOSnapshotHeader header;
+        file >> header;
+        if (header.nVersion != CUTXOSnapshotHeader::CURRENT_VERSION)
+            return error("%s: unsupported snapshot version %u", __func__, header.nVersion);
+        if (memcmp(header.pchMessageStart, chainparams.MessageStart(), sizeof(header.pchMessageStart)))
+            return error("%s: the snapshot is for a different network", __func__);
+        if (header.hashSerialized != hashExpected)
+            return error("%s: the snapshot commits to hash %s, not the expected %s", __func__,
+                header.hashSerialized.ToString(), hashExpected.ToString());
+        if (header.nHeight <= 0)
+            return error("%s: the snapshot has no blocks past genesis", __func__);
+
+        // Accept the header chain as if it had come from a peer, so that it is checked the same way.
+        std::vector<unsigned int> vTx;
+        vTx.reserve(header.nHeight);
+        CBlockIndex *pindex = nullptr;
+        for (int32_t i = 0; i < header.nHeight; i++)
+        {
+            CBlockHeader blockheader;
+            uint32_t nTx;
+            file >> blockheader >> nTx;
+            CValidationState state;
+            if (!AcceptBlockHeader(blockheader, state, chainparams, &pindex))
+                return error("%s: invalid header at height %d: %s", __func__, i + 1, state.GetRejectReason());
+            if (nTx == 0)
+                return error("%s: no transaction count for the block at height %d", __func__, i + 1);
+            vTx.push_back(nTx);
+        }
+        if (pindex->GetBlockHash() != header.hashBlock)
+            return error("%s: the header chain does not lead to the snapshot block", __func__);
+
+        // Check the coins against the committed hash before any of them is written.
+        long nCoinsPos = ftell(file.Get());
+        CCoinsStats stats;
+        CCoinsStatsHasher hasher(stats, header.hashBlock);
+        for (uint64_t i = 0; i < header.nCoins; i++)
+        {
+            COutPoint key;
+            Coin coin;
+            file >> key >> coin;
+            hasher.Add(key, std::move(coin));
+        }
+        if (hasher.Finalize() != header.hashSerialized)
+            return error("%s: the snapshot coins do not match its hash", __func__);
+
+        // Write the coins, and the best block only once they are all in.
+        if (nCoinsPos < 0 || fseek(file.Get(), nCoinsPos, SEEK_SET))
+            return error("%s: unable to seek in %s", __func__, path.string());
+        for (uint64_t i = 0; i < header.nCoins;)
+        {
+            CCoinsViewCache cache(pcoinsdbview);
+            for (uint64_t n = 0; n < SNAPSHOT_LOAD_BATCH && i < header.nCoins; n++, i++)
+            {
+                COutPoint key;
+                Coin coin;
+                file >> key >> coin;
+                cache.AddCoin(key, std::move(coin), false);
+            }
+            if (!cache.Flush())
+                return error("%s: unable to write to the coin database", __func__);
+        }
+        {
+            CCoinsViewCache cache(pcoinsdbview);
+            cache.SetBestBlock(header.hashBlock);
+            if (!cache.Flush() || !pcoinsdbview->WaitForFlush())
+                return error("%s: unable to write to the coin database", __func__);
+        }
+        pcoinsTip->SetBestBlock(header.hashBlock);
+
+        SetSnapshotTip(pindex, vTx);
+        CValidationState state;
+        if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
+            return error("%s: unable to write the block index: %s", __func__, state.GetRejectReason());
+
+        LOGA("Loaded UTXO snapshot of %u coins at block %s height %d in %.2fs\n", header.nCoins,
+            header.hashBlock.ToString(), header.nHeight, (GetStopwatchMicros() - nStart) * 0.000001);
+    }
+    catch (const std::exception &e)
+    {
+        return error("%s: unable to read %s: %s", __func__, path.string(), e.what());
+    }
+    return true;
+}
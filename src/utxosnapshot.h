@@ -0,0 +1,74 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTXOSNAPSHOT_H
+#define BITCOIN_UTXOSNAPSHOT_H
+
+#include "coins.h"
+#include "fs.h"
+#include "protocol.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <string.h>
+
+class CChainParams;
+class CCoinsViewDB;
+
+/**
+ * A UTXO snapshot holds the unspent output set as of some block (the base block) together with the header chain
+ * that leads to it, so that a new node can start validating from the base block without downloading and replaying
+ * the blocks below it.  The file is laid out as
+ *
+ *   CUTXOSnapshotHeader
+ *   nHeight x (CBlockHeader, transaction count)   for the blocks at height 1 to nHeight
+ *   nCoins x (COutPoint, Coin)                      in coin database order
+ *
+ * and the header commits to the gettxoutsetinfo hash_serialized_2 of the coins.
+ */
+class CUTXOSnapshotHeader
+{
+public:
+    static const uint32_t CURRENT_VERSION = 1;
+
+    uint32_t nVersion;
+    CMessageHeader::MessageStartChars pchMessageStart;
+    uint256 hashBlock;
+    int32_t nHeight;
+    uint64_t nCoins;
+    uint256 hashSerialized;
+
+    CUTXOSnapshotHeader() : nVersion(CURRENT_VERSION), nHeight(0), nCoins(0)
+    {
+        memset(pchMessageStart, 0, sizeof(pchMessageStart));
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream &s, Operation ser_action)
+    {
+        READWRITE(nVersion);
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nCoins);
+        READWRITE(hashSerialized);
+    }
+};
+
+/**
+ * Write the coin database and the header chain leading to its best block to path.  The caller must make sure
+ * the database is flushed and hold cs_main while the cursor is created.  Throws on I/O errors.
+ */
+CUTXOSnapshotHeader DumpUTXOSnapshot(CCoinsViewDB *view, const fs::path &path);
+
+/**
+ * Load the snapshot at path into an empty chainstate and make its base block the chain tip.  The snapshot is only
+ * used if its coins hash to hashExpected, which should come from gettxoutsetinfo on a trusted node.  Does nothing
+ * if the chain has already advanced past the genesis block.
+ */
+bool LoadUTXOSnapshot(const fs::path &path, const uint256 &hashExpected, const CChainParams &chainparams);
+
+#endif // BITCOIN_UTXOSNAPSHOT_H
@@ -0,0 +1,214 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxostats.h"
+
+#include "blockstorage/blockstorage.h"
+#include "coins.h"
+#include "consensus/validation.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "txdb.h"
+#include "undo.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <atomic>
+#include <thread>
+
+//! Upper bound on the threads a full scan is split across; each needs its own database iterator
+static const int MAX_SCAN_THREADS = 16;
+
+std::unique_ptr<CUTXOStats> g_utxostats;
+
+void CUTXOStats::AddOutput(const COutPoint &outpoint,
+    const CTxOut &out,
+    uint32_t nHeight,
+    bool fCoinBase,
+    bool fRemove)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << outpoint;
+    ss << (uint32_t)(nHeight * 2 + fCoinBase);
+    ss << out;
+    if (fRemove)
+    {
+        muhash.Remove((const unsigned char *)ss.data(), ss.size());
+        nTransactionOutputs--;
+        nTotalAmount -= out.nValue;
+    }
+    else
+    {
+        muhash.Insert((const unsigned char *)ss.data(), ss.size());
+        nTransactionOutputs++;
+        nTotalAmount += out.nValue;
+    }
+}
+
+void CUTXOStats::AddCoin(const COutPoint &outpoint, const Coin &coin)
+{
+    AddOutput(outpoint, coin.out, coin.nHeight, coin.fCoinBase, false);
+}
+
+void CUTXOStats::RemoveCoin(const COutPoint &outpoint, const Coin &coin)
+{
+    AddOutput(outpoint, coin.out, coin.nHeight, coin.fCoinBase, true);
+}
+
+void CUTXOStats::ConnectBlock(const CBlock &block, const CBlockUndo &blockundo, int nHeight)
+{
+    for (size_t i = 1; i < block.vtx.size() && i <= blockundo.vtxundo.size(); i++)
+    {
+        const CTransaction &tx = *block.vtx[i];
+        const CTxUndo &txundo = blockundo.vtxundo[i - 1];
+        for (size_t j = 0; j < tx.vin.size() && j < txundo.vprevout.size(); j++)
+            RemoveCoin(tx.vin[j].prevout, txundo.vprevout[j]);
+    }
+    for (size_t i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = *block.vtx[i];
+        for (size_t o = 0; o < tx.vout.size(); o++)
+        {
+            // unspendable outputs never make it into the coin database
+            if (!tx.vout[o].scriptPubKey.IsUnspendable())
+                AddOutput(COutPoint(tx.GetHash(), o), tx.vout[o], nHeight, i == 0, false);
+        }
+    }
+}
+
+void CUTXOStats::DisconnectBlock(const CBlock &block, const CBlockUndo &blockundo, int nHeight)
+{
+    for (size_t i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = *block.vtx[i];
+        if (i > 0 && (i > blockundo.vtxundo.size() || blockundo.vtxundo[i - 1].vprevout.size() != tx.vin.size()))
+            continue;
+        for (size_t o = 0; o < tx.vout.size(); o++)
+        {
+            if (!tx.vout[o].scriptPubKey.IsUnspendable())
+                AddOutput(COutPoint(tx.GetHash(), o), tx.vout[o], nHeight, i == 0, true);
+        }
+        if (i > 0)
+        {
+            const CTxUndo &txundo = blockundo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); j++)
+                AddCoin(tx.vin[j].prevout, txundo.vprevout[j]);
+        }
+    }
+}
+
+void CUTXOStats::Apply(const CUTXOStats &delta)
+{
+    muhash *= delta.muhash;
+    nTransactionOutputs += delta.nTransactionOutputs;
+    nTotalAmount += delta.nTotalAmount;
+}
+
+uint256 CUTXOStats::GetMuHash() const
+{
+    MuHash3072 copy(muhash);
+    uint256 hash;
+    copy.Finalize(hash.begin());
+    return hash;
+}
+
+bool ScanUTXOStats(CCoinsViewDB *view, CUTXOStats &stats, std::unique_ptr<CUTXOStats> *pRunning)
+{
+    int64_t nStart = GetStopwatchMicros();
+    int nThreads = std::max(1, std::min(GetNumCores(), MAX_SCAN_THREADS));
+
+    // Leveldb iterators read from a snapshot taken when they are created, so creating them all while no block can
+    // be connected gives every thread the same set of coins.
+    std::vector<std::unique_ptr<CCoinsViewCursor> > cursors(nThreads);
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
+            return error("%s: unable to flush the chainstate: %s", __func__, state.GetRejectReason());
+        for (int i = 0; i < nThreads; i++)
+        {
+            uint256 hashStart;
+            *hashStart.begin() = i * 256 / nThreads;
+            cursors[i].reset(view->Cursor(hashStart));
+        }
+        if (pRunning)
+            pRunning->reset(g_utxostats ? new CUTXOStats(*g_utxostats) : nullptr);
+    }
+
+    // Thread i covers the txids whose first byte is in [i * 256 / nThreads, (i + 1) * 256 / nThreads)
+    std::vector<CUTXOStats> parts(nThreads);
+    std::atomic<bool> fError{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++)
+    {
+        threads.emplace_back([&cursors, &parts, &fError, i, nThreads]() {
+            unsigned int nEnd = (i + 1) * 256 / nThreads;
+            CCoinsViewCursor *pcursor = cursors[i].get();
+            for (; pcursor->Valid() && !fError; pcursor->Next())
+            {
+                COutPoint key;
+                Coin coin;
+                if (!pcursor->GetKey(key) || !pcursor->GetValue(coin))
+                {
+                    fError = true;
+                    break;
+                }
+                if (*key.hash.begin() >= nEnd)
+                    break;
+                parts[i].AddCoin(key, coin);
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    if (fError)
+        return error("%s: unable to read the coin database", __func__);
+
+    stats = CUTXOStats();
+    stats.hashBlock = cursors[0]->GetBestBlock();
+    for (const CUTXOStats &part : parts)
+        stats.Apply(part);
+    LOG(COINDB, "Scanned %d coins on %d threads in %.2fs\n", stats.nTransactionOutputs, nThreads,
+        (GetStopwatchMicros() - nStart) * 0.000001);
+    return true;
+}
+
+bool LoadUTXOStats(CCoinsViewDB *view)
+{
+    LOCK(cs_main);
+    g_utxostats.reset();
+    if (!GetBoolArg("-utxostats", DEFAULT_UTXOSTATS))
+        return true;
+
+    // The statistics are written with a full flush, but the coins of that flush may not have made it to disk.
+    std::unique_ptr<CUTXOStats> stats(new CUTXOStats());
+    CValidationState state;
+    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
+        return error("%s: unable to flush the chainstate: %s", __func__, state.GetRejectReason());
+    if (!view->ReadUTXOStats(*stats) || stats->hashBlock != view->GetBestBlock())
+    {
+        LOGA("Computing the UTXO set statistics at block %s\n", view->GetBestBlock().ToString());
+        if (!ScanUTXOStats(view, *stats))
+            return false;
+    }
+    g_utxostats = std::move(stats);
+    return true;
+}
+
+void UpdateUTXOStats(const CUTXOStats &delta, const uint256 &hashPrevBlock)
+{
+    AssertLockHeld(cs_main);
+    if (!g_utxostats)
+        return;
+    if (g_utxostats->hashBlock != hashPrevBlock)
+    {
+        LOGA("UTXO set statistics are for block %s, not the parent %s of the new tip; no longer maintaining them\n",
+            g_utxostats->hashBlock.ToString(), hashPrevBlock.ToString());
+        g_utxostats.reset();
+        return;
+    }
+    g_utxostats->Apply(delta);
+    g_utxostats->hashBlock = delta.hashBlock;
+}
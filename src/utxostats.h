@@ -0,0 +1,97 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTXOSTATS_H
+#define BITCOIN_UTXOSTATS_H
+
+#include "amount.h"
+#include "crypto/muhash.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <memory>
+
+class CBlock;
+class CBlockUndo;
+class CCoinsViewDB;
+class COutPoint;
+class CTxOut;
+class Coin;
+
+//! Whether to keep the UTXO set statistics up to date as blocks are connected, so gettxoutsetinfo is instant
+static const bool DEFAULT_UTXOSTATS = true;
+
+/**
+ * The statistics of the unspent output set that can be kept up to date one block at a time: a MuHash3072 over the
+ * coins, which does not depend on the order they are added and removed in, their number and their total value.
+ * The same class holds the change that a single block makes to them, and the part of a full scan done by one thread.
+ */
+class CUTXOStats
+{
+private:
+    void AddOutput(const COutPoint &outpoint, const CTxOut &out, uint32_t nHeight, bool fCoinBase, bool fRemove);
+
+public:
+    //! the block the statistics are for
+    uint256 hashBlock;
+    MuHash3072 muhash;
+    int64_t nTransactionOutputs;
+    CAmount nTotalAmount;
+
+    CUTXOStats() : nTransactionOutputs(0), nTotalAmount(0) {}
+
+    void AddCoin(const COutPoint &outpoint, const Coin &coin);
+    void RemoveCoin(const COutPoint &outpoint, const Coin &coin);
+
+    /** Remove the coins block spends, as recorded in blockundo, and add the ones it creates */
+    void ConnectBlock(const CBlock &block, const CBlockUndo &blockundo, int nHeight);
+    /** The reverse of ConnectBlock.  Transactions whose undo data does not match them are skipped. */
+    void DisconnectBlock(const CBlock &block, const CBlockUndo &blockundo, int nHeight);
+
+    /** Add in a change, or the statistics of a disjoint part of the same set.  hashBlock is left alone. */
+    void Apply(const CUTXOStats &delta);
+
+    /** The hash of the set; only the set of coins matters, not how it was built */
+    uint256 GetMuHash() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream &s, Operation ser_action)
+    {
+        READWRITE(hashBlock);
+        unsigned char state[MuHash3072::SERIALIZED_SIZE];
+        if (!ser_action.ForRead())
+            muhash.GetBytes(state);
+        READWRITE(FLATDATA(state));
+        if (ser_action.ForRead())
+            muhash.SetBytes(state);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nTotalAmount);
+    }
+};
+
+/**
+ * The statistics of the coin database as of the chain tip, or null if they are not being maintained.  They are
+ * updated by ConnectTip and DisconnectTip and written to the coin database on every full flush.  Protected by cs_main.
+ */
+extern std::unique_ptr<CUTXOStats> g_utxostats;
+
+/**
+ * Compute the statistics of the coin database with a full scan, split by txid into ranges that are scanned in
+ * parallel.  The database is flushed first.  If pRunning is given it is set to a copy of g_utxostats as of the same
+ * block, so that the two can be compared.
+ */
+bool ScanUTXOStats(CCoinsViewDB *view, CUTXOStats &stats, std::unique_ptr<CUTXOStats> *pRunning = nullptr);
+
+/**
+ * Set up g_utxostats, from the copy stored in the coin database if it is for the database's best block and from a
+ * full scan otherwise.  Does nothing when -utxostats is off.
+ */
+bool LoadUTXOStats(CCoinsViewDB *view);
+
+/** Apply the change that the block delta.hashBlock made to g_utxostats, if the statistics are at its parent */
+void UpdateUTXOStats(const CUTXOStats &delta, const uint256 &hashPrevBlock);
+
+#endif // BITCOIN_UTXOSTATS_H
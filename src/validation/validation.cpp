@@ -23,6 +23,7 @@
 #include "txadmission.h"
 #include "txorphanpool.h"
 #include "ui_interface.h"
+#include "utxostats.h"
 #include "validationinterface.h"
 
 #include <boost/scope_exit.hpp>
@@ -505,6 +506,36 @@ bool LoadBlockIndexDB()
     return true;
 }
 
+void SetSnapshotTip(CBlockIndex *pindex, const std::vector<unsigned int> &vTx)
+{
+    AssertLockHeld(cs_main);
+    {
+        WRITELOCK(cs_mapBlockIndex);
+        assert(vTx.size() == (size_t)pindex->nHeight);
+        std::vector<CBlockIndex *> vChain(pindex->nHeight + 1);
+        for (CBlockIndex *pindexWalk = pindex; pindexWalk; pindexWalk = pindexWalk->pprev)
+            vChain[pindexWalk->nHeight] = pindexWalk;
+        for (CBlockIndex *pindexWalk : vChain)
+        {
+            if (pindexWalk->pprev)
+            {
+                pindexWalk->nTx = vTx[pindexWalk->nHeight - 1];
+                pindexWalk->nChainTx = pindexWalk->pprev->nChainTx + pindexWalk->nTx;
+                pindexWalk->RaiseValidity(BLOCK_VALID_SCRIPTS);
+                setDirtyBlockIndex.insert(pindexWalk);
+            }
+        }
+    }
+    setBlockIndexCandidates.insert(pindex);
+    chainActive.SetTip(pindex);
+    PruneBlockIndexCandidates();
+
+    // The blocks below the snapshot are missing, which the rest of the node already handles for pruned block files.
+    fHavePruned = true;
+    pblocktree->WriteFlag("prunedblockfiles", true);
+    pblocktree->WriteFlag("utxosnapshot", true);
+}
+
 void UnloadBlockIndex()
 {
     {
@@ -1567,7 +1598,7 @@ bool CheckBlock(const CBlock &block, CValidationState &state, bool fCheckPOW, bo
     if (fCheckMerkleRoot)
     {
         bool mutated;
-        uint256 hashMerkleRoot2 = BlockMerkleRoot(block, &mutated);
+        uint256 hashMerkleRoot2 = PV ? PV->BlockMerkleRoot(block, &mutated) : BlockMerkleRoot(block, &mutated);
         if (block.hashMerkleRoot != hashMerkleRoot2)
             return state.DoS(
                 100, error("CheckBlock(): hashMerkleRoot mismatch"), REJECT_INVALID, "bad-txnmrklroot", true);
@@ -1884,7 +1915,10 @@ int ApplyTxInUndo(Coin &&undo, CCoinsViewCache &view, const COutPoint &out)
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult DisconnectBlock(const CBlock &block, const CBlockIndex *pindex, CCoinsViewCache &view)
+DisconnectResult DisconnectBlock(const CBlock &block,
+    const CBlockIndex *pindex,
+    CCoinsViewCache &view,
+    CUTXOStats *pStatsDelta)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
 
@@ -1908,6 +1942,8 @@ DisconnectResult DisconnectBlock(const CBlock &block, const CBlockIndex *pindex,
         error("DisconnectBlock(): block and undo data inconsistent");
         return DISCONNECT_FAILED;
     }
+    if (pStatsDelta)
+        pStatsDelta->DisconnectBlock(block, blockUndo, pindex->nHeight);
     // undo transactions in reverse of the OTI algorithm order (so add inputs first, then remove outputs)
     // we can use this algorithm for both dtor and ctor because we are undoing a validated block so
     // we already know that the block is valid.
@@ -2528,7 +2564,8 @@ bool ConnectBlock(const CBlock &block,
     CCoinsViewCache &view,
     const CChainParams &chainparams,
     bool fJustCheck,
-    bool fParallel)
+    bool fParallel,
+    CUTXOStats *pStatsDelta)
 {
     // pindex should be the header structure for this new block.  Check this by making sure that the nonces are the
     // same.
@@ -2596,6 +2633,18 @@ bool ConnectBlock(const CBlock &block,
         }
     }
 
+    // The two blocks that broke BIP30 overwrote unspent coinbase outputs, which their undo data does not record
+    if (pStatsDelta && !fJustCheck && (pindex->nHeight == 91842 || pindex->nHeight == 91880))
+    {
+        for (size_t o = 0; o < block.vtx[0]->vout.size(); o++)
+        {
+            COutPoint outpoint(block.vtx[0]->GetHash(), o);
+            Coin coin;
+            if (view.GetCoin(outpoint, coin))
+                pStatsDelta->RemoveCoin(outpoint, coin);
+        }
+    }
+
     if (canonical)
     {
         if (!ConnectBlockCanonicalOrdering(
@@ -2636,6 +2685,9 @@ bool ConnectBlock(const CBlock &block,
     // Quit any competing threads may be validating which have the same previous block before updating the UTXO.
     PV->QuitCompetingThreads(block.GetBlockHeader().hashPrevBlock);
 
+    if (pStatsDelta)
+        pStatsDelta->ConnectBlock(block, blockundo, pindex->nHeight);
+
     // Write undo information to disk
     {
         if (pindex->GetUndoPos().IsNull() || !pindex->IsValid(BLOCK_VALID_SCRIPTS))
@@ -2939,7 +2991,7 @@ static void ResubmitTransactions(CBlock &block)
     // dependency chain in the mempool performed terribly.
     //
     // We must hold the mempool lock throughout otherwise it would be possible for some txns to slip back into
-    // the mempool from the csCommitQFinal.
+    // the mempool from the batch the commit thread is working on.
     WRITELOCK(mempool.cs_txmempool);
     {
         // Resubmit the block first
@@ -2963,29 +3015,14 @@ static void ResubmitTransactions(CBlock &block)
         });
 
         // Clear txCommitQ
+        std::vector<CTxCommitData> vCommitQ;
+        txCommitQ.Clear(&vCommitQ);
+        for (const CTxCommitData &data : vCommitQ)
         {
-            boost::unique_lock<boost::mutex> lock(csCommitQ);
-            for (auto &kv : *txCommitQ)
-            {
-                CTxInputData txd;
-                txd.tx = kv.second.entry.GetSharedTx();
-                txd.nodeName = "rollback";
-                EnqueueTxForAdmission(txd);
-            }
-            txCommitQ->clear();
-        }
-
-        // Clear txCommitQFinal
-        {
-            LOCK(csCommitQFinal);
-            for (auto &kv : *txCommitQFinal)
-            {
-                CTxInputData txd;
-                txd.tx = kv.second.entry.GetSharedTx();
-                txd.nodeName = "rollback";
-                EnqueueTxForAdmission(txd);
-            }
-            txCommitQFinal->clear();
+            CTxInputData txd;
+            txd.tx = data.entry.GetSharedTx();
+            txd.nodeName = "rollback";
+            EnqueueTxForAdmission(txd);
         }
     }
 }
@@ -3005,10 +3042,13 @@ bool DisconnectTip(CValidationState &state, const Consensus::Params &consensusPa
     int64_t nStart = GetStopwatchMicros();
     {
         CCoinsViewCache view(pcoinsTip);
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
+        CUTXOStats statsDelta;
+        if (DisconnectBlock(block, pindexDelete, view, g_utxostats ? &statsDelta : nullptr) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool result = view.Flush();
         assert(result);
+        statsDelta.hashBlock = pindexDelete->pprev->GetBlockHash();
+        UpdateUTXOStats(statsDelta, pindexDelete->GetBlockHash());
     }
     LOG(BENCH, "- Disconnect block: %.2fms\n", (GetStopwatchMicros() - nStart) * 0.001);
     // Write the chain state to disk, if necessary.
@@ -3037,8 +3077,7 @@ bool DisconnectTip(CValidationState &state, const Consensus::Params &consensusPa
     if (fRollBack)
     {
         mempool.clear();
-        boost::unique_lock<boost::mutex> lock(csCommitQ);
-        txCommitQ->clear();
+        txCommitQ.Clear();
     }
     else
     {
@@ -3091,7 +3130,9 @@ bool ConnectTip(CValidationState &state,
     LOG(BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
         CCoinsViewCache view(pcoinsTip);
-        bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainparams, false, fParallel);
+        CUTXOStats statsDelta;
+        bool rv = ConnectBlock(
+            *pblock, state, pindexNew, view, chainparams, false, fParallel, g_utxostats ? &statsDelta : nullptr);
         GetMainSignals().BlockChecked(*pblock, state);
         if (!rv)
         {
@@ -3106,6 +3147,8 @@ bool ConnectTip(CValidationState &state,
         bool result = view.Flush();
         nBlockSizeAtChainTip.store(pblock->GetBlockSize());
         assert(result);
+        statsDelta.hashBlock = pindexNew->GetBlockHash();
+        UpdateUTXOStats(statsDelta, pindexNew->pprev ? pindexNew->pprev->GetBlockHash() : uint256());
         LOG(BENCH, "      - Update Coins %.3fms\n", GetStopwatchMicros() - nStart);
 
         mapBlockSource.erase(pindexNew->GetBlockHash());
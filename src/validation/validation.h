@@ -16,6 +16,8 @@
 #include "txmempool.h"
 #include "versionbits.h"
 
+class CUTXOStats;
+
 extern std::atomic<uint64_t> nBlockSizeAtChainTip;
 
 enum DisconnectResult
@@ -54,6 +56,13 @@ bool LoadBlockIndex();
 /** Initialize a new block tree database + block data on disk */
 bool InitBlockIndex(const CChainParams &chainparams);
 
+/**
+ * Make pindex the chain tip after its coins have been loaded from a UTXO snapshot.  The blocks below it are marked
+ * as fully validated but without data, the same as if they had been pruned.  vTx holds the transaction counts of
+ * the blocks from height 1 up to pindex.
+ */
+void SetSnapshotTip(CBlockIndex *pindex, const std::vector<unsigned int> &vTx);
+
 void CheckBlockIndex(const Consensus::Params &consensusParams);
 
 /**
@@ -120,16 +129,21 @@ uint32_t GetBlockScriptFlags(const CBlockIndex *pindex, const Consensus::Params
  *  In case pfClean is provided, operation will try to be tolerant about errors, and *pfClean
  *  will be true if no problems were found. Otherwise, the return value will be false in case
  *  of problems. Note that in any case, coins may be modified. */
-DisconnectResult DisconnectBlock(const CBlock &block, const CBlockIndex *pindex, CCoinsViewCache &view);
+DisconnectResult DisconnectBlock(const CBlock &block,
+    const CBlockIndex *pindex,
+    CCoinsViewCache &view,
+    CUTXOStats *pStatsDelta = nullptr);
 
-/** Apply the effects of this block (with given index) on the UTXO set represented by coins */
+/** Apply the effects of this block (with given index) on the UTXO set represented by coins.  If pStatsDelta is given
+ *  the change to the UTXO set statistics is recorded in it, for the caller to apply once the view is committed. */
 bool ConnectBlock(const CBlock &block,
     CValidationState &state,
     CBlockIndex *pindex,
     CCoinsViewCache &view,
     const CChainParams &chainparams,
     bool fJustCheck = false,
-    bool fParallel = false);
+    bool fParallel = false,
+    CUTXOStats *pStatsDelta = nullptr);
 
 /** Disconnect the current chainActive.Tip() */
 bool DisconnectTip(CValidationState &state, const Consensus::Params &consensusParams, const bool fRollBack = false);
@@ -45,7 +45,7 @@ bool CVerifyDB::VerifyDB(const CChainParams &chainparams, CCoinsView *coinsview,
             break;
         {
             READLOCK(cs_mapBlockIndex); // for nStatus
-            if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA))
+            if ((fPruneMode || fHavePruned) && !(pindex->nStatus & BLOCK_HAVE_DATA))
             {
                 // If pruning, only go back as far as we have data.
                 LOGA("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);